@@ -222,6 +222,7 @@ async def health_check() -> Dict[str, Any]:
             - service: Service name
             - security_level: Current security level
             - version: Service version
+            - analyzer_metrics: Native analyzer latency and counters, if available
     """
     try:
         # Test the security service with a simple validation
@@ -247,7 +248,8 @@ async def health_check() -> Dict[str, Any]:
                     "misses": redis_service.get_counter("cache_misses") or 0,
                     "validation_keys": redis_info.get("validation_cache_keys", 0)
                 }
-            }
+            },
+            "analyzer_metrics": security_service.analyzer.native_metrics()
         }
         
     except Exception as e:
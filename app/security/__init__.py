@@ -4,18 +4,21 @@ This module provides a Python interface to the C++ security analyzer for file an
 and a Python-based analyzer for text analysis.
 """
 import logging
-from typing import Dict, Any, Union, List
+from typing import Dict, Any, Optional, Union, List
 from pathlib import Path
 import os
 import json
 import requests
 import re
+import time
 
 logger = logging.getLogger(__name__)
 
 # --- C++ Module Loading ---
 try:
-    from security_analyzer import AnalysisResult, SecurityAnalyzer as CppSecurityAnalyzer
+    from security_analyzer import (AnalysisProfile as CppAnalysisProfile, AnalysisResult, Ruleset as CppRuleset,
+                                   RulesetDirectory as CppRulesetDirectory, RulesetFollower as CppRulesetFollower,
+                                   SecurityAnalyzer as CppSecurityAnalyzer)
     _cpp_available = True
     logger.info("C++ security analyzer module loaded successfully.")
 except ImportError as e:
@@ -34,6 +37,14 @@ try:
 except Exception as e:
     logger.warning(f"Failed to load harmful_keywords.json: {e}")
 
+# Native profile that analyze_text runs under when no other is named. Text
+# validation never looked for PII (the Python checks below do not either), so
+# neither do its profiles; files still get the full scan.
+_TEXT_PROFILE = "text"
+
+# How often analyzers following SECURITY_RULESET_DIR look for a new generation
+_RULESET_POLL_SECONDS = float(os.getenv("SECURITY_RULESET_POLL_SECONDS", "1.0"))
+
 _GEMINI_API_KEY = os.getenv("GEMINI_API_KEY")
 _GEMINI_ENDPOINT = (
     "https://generativelanguage.googleapis.com/v1beta/models/gemini-1.5-flash:generateContent"
@@ -61,11 +72,23 @@ class SecurityAnalyzer:
 
         # Python Analyzer Resources
         self.harmful_keywords: List[str] = []
+        self.native_keywords = False
+        self._ruleset_follower = None
+        self._next_ruleset_poll = 0.0
         try:
             kw_path = Path(__file__).parent / "harmful_keywords.json"
             if kw_path.exists():
                 with open(kw_path, "r", encoding="utf-8") as kw_file:
                     self.harmful_keywords = json.load(kw_file)
+                if self.cpp_analyzer:
+                    # Compile the keywords into the native matcher so one scan covers them
+                    shared_dir = os.getenv("SECURITY_RULESET_DIR")
+                    if shared_dir:
+                        self._follow_shared_ruleset(shared_dir, kw_path)
+                    else:
+                        self.cpp_analyzer.set_ruleset(self._load_native_ruleset(kw_path))
+                    self.set_profile(_TEXT_PROFILE, threshold=threshold)
+                    self.native_keywords = True
         except Exception as e:
             logger.warning(f"Failed to load harmful_keywords.json: {e}")
 
@@ -75,6 +98,52 @@ class SecurityAnalyzer:
             if self.gemini_api_key else None
         )
 
+    @staticmethod
+    def _load_native_ruleset(kw_path: Path):
+        """Map the precompiled ruleset if it is up to date, else compile the keyword file."""
+        compiled = Path(os.getenv("SECURITY_RULESET_FILE", kw_path.with_suffix(".rules")))
+        if compiled.exists() and compiled.stat().st_mtime >= kw_path.stat().st_mtime:
+            try:
+                return CppRuleset.open(str(compiled))
+            except Exception as e:
+                logger.warning(f"Ignoring compiled ruleset {compiled}: {e}")
+        return CppRuleset.load([str(kw_path)])
+
+    def _follow_shared_ruleset(self, shared_dir: str, kw_path: Path) -> None:
+        """Map the ruleset generation published in shared_dir, publishing the keyword rules if none is.
+
+        Prefork workers pointed at one directory (ideally on /dev/shm) share a single copy of the
+        compiled tables; `compile_ruleset --publish DIR` hot-reloads them all.
+        """
+        directory = CppRulesetDirectory(shared_dir)
+        if directory.current_generation == 0:
+            directory.publish(self._load_native_ruleset(kw_path))
+        self._ruleset_follower = CppRulesetFollower(self.cpp_analyzer, directory)
+        self._ruleset_follower.poll()
+
+    def _poll_shared_ruleset(self) -> None:
+        """Pick up a newly published ruleset generation, at most once per poll interval."""
+        if self._ruleset_follower is None:
+            return
+        now = time.monotonic()
+        if now < self._next_ruleset_poll:
+            return
+        self._next_ruleset_poll = now + _RULESET_POLL_SECONDS
+        try:
+            self._ruleset_follower.poll()
+        except Exception as e:
+            logger.warning(f"Keeping ruleset generation {self._ruleset_follower.generation}: {e}")
+
+    def set_profile(self, profile_id: str, threshold: float, categories: Optional[List[str]] = None,
+                    weights: Optional[Dict[str, float]] = None, detect_pii: bool = False) -> None:
+        """Register a named native profile for analyze_text and analyze_file, so callers with different policies share this analyzer.
+
+        PII is off by default to match the Python checks, which never flag it in text.
+        """
+        if self.cpp_analyzer:
+            self.cpp_analyzer.set_profile(profile_id, CppAnalysisProfile(
+                threshold=threshold, categories=categories or [], weights=weights or {}, detect_pii=detect_pii))
+
     def detect_code_injection(self, text: str) -> List[str]:
         """Detect various types of code injection attempts."""
         issues = []
@@ -232,25 +301,37 @@ class SecurityAnalyzer:
         
         return issues
 
-    def analyze_text(self, text: str) -> Dict[str, Any]:
+    def analyze_text(self, text: str, profile_id: Optional[str] = None) -> Dict[str, Any]:
         """Analyzes text using Python-based keyword, code injection, and LLM checks."""
         issues: List[str] = []
+        self._poll_shared_ruleset()
         
-        # Check for code injection patterns first
-        injection_issues = self.detect_code_injection(text)
-        if injection_issues:
-            issues.extend(injection_issues)
-        
-        # Rule-based keyword checks with word boundaries to avoid false positives
-        text_lower = text.lower()
-        for keyword in self.harmful_keywords:
-            # Use word boundaries to match whole words only
-            pattern = r'\b' + re.escape(keyword.lower()) + r'\b'
-            if re.search(pattern, text_lower):
-                issues.append('harmful_keyword_detected')
-                break  # One match is enough
+        if self.native_keywords:
+            # One native pass covers code injection, PII and the harmful keywords, scored and
+            # judged under the profile's weights and threshold
+            native = self.cpp_analyzer.analyze_text(text, profile_id or _TEXT_PROFILE)
+            issues.extend(native.detected_issues)
+            rules_safe = native.is_safe
+            rules_score = native.confidence_score
+        else:
+            # Check for code injection patterns first
+            injection_issues = self.detect_code_injection(text)
+            if injection_issues:
+                issues.extend(injection_issues)
+            
+            # Rule-based keyword checks with word boundaries to avoid false positives
+            text_lower = text.lower()
+            for keyword in self.harmful_keywords:
+                # Use word boundaries to match whole words only
+                pattern = r'\b' + re.escape(keyword.lower()) + r'\b'
+                if re.search(pattern, text_lower):
+                    issues.append('harmful_keyword_detected')
+                    break  # One match is enough
+            rules_safe = not issues
+            rules_score = 1.0 if rules_safe else 0.0
         
         # LLM-based analysis
+        llm_issues: List[str] = []
         llm_score = 1.0
         if self.gemini_endpoint and text.strip():
             try:
@@ -265,23 +346,24 @@ class SecurityAnalyzer:
                     response_data = resp.json()
                     # This parsing is a placeholder and depends on the exact Gemini API response structure for safety ratings
                     if "promptFeedback" in response_data and response_data["promptFeedback"]["blockReason"]:
-                        issues.append('llm_flagged_unsafe')
+                        llm_issues.append('llm_flagged_unsafe')
                         llm_score = 0.0
                 else:
                     logger.warning(f"Gemini API call failed with status {resp.status_code}: {resp.text}")
             except Exception as e:
                 logger.error(f"Gemini API call exception: {e}", exc_info=True)
 
-        is_safe = not issues
         return {
-            'is_safe': is_safe,
-            'confidence_score': llm_score if is_safe else 0.0,
-            'detected_issues': issues,
+            'is_safe': rules_safe and not llm_issues,
+            'confidence_score': min(rules_score, llm_score),
+            'rule_score': rules_score,
+            'llm_score': llm_score,
+            'detected_issues': issues + llm_issues,
             'analysis_summary': 'Python-based text analysis (Code Injection + Keywords + LLM)'
         }
 
-    def analyze_file(self, file_path: Union[str, os.PathLike]) -> Dict[str, Any]:
-        """Analyzes a file using the C++ engine."""
+    def analyze_file(self, file_path: Union[str, os.PathLike], profile_id: Optional[str] = None) -> Dict[str, Any]:
+        """Analyzes a file using the C++ engine, under a profile from set_profile when one is named."""
         if not self.cpp_analyzer:
             return {
                 'is_safe': False,
@@ -294,26 +376,13 @@ class SecurityAnalyzer:
         if not file_path.exists():
             raise FileNotFoundError(f"File not found: {file_path}")
         
+        self._poll_shared_ruleset()
         try:
-            with open(file_path, 'rb') as f:
-                data = f.read()
-
-            # --- File type detection ---
-            is_pdf = data[:4] == b'%PDF'
-
-            if is_pdf:
-                try:
-                    # Convert bytes to list of integers for C++ function
-                    pdf_data_list = list(data)
-                    result: AnalysisResult = self.cpp_analyzer.analyze_pdf(pdf_data_list)
-                except Exception as e:
-                    logger.error(f"C++ PDF analysis failed, falling back to text: {e}")
-                    text_content = data.decode('utf-8', errors='ignore')
-                    result: AnalysisResult = self.cpp_analyzer.analyze_text(text_content)
+            # The C++ engine maps the file and picks PDF or text from its magic bytes
+            if profile_id:
+                result: AnalysisResult = self.cpp_analyzer.analyze_file(str(file_path), profile_id)
             else:
-                # Treat as text (assuming UTF-8 or ASCII). Non-UTF8 bytes are ignored.
-                text_content = data.decode('utf-8', errors='ignore')
-                result: AnalysisResult = self.cpp_analyzer.analyze_text(text_content)
+                result = self.cpp_analyzer.analyze_file(str(file_path))
 
             # Convert the C++ result object to a dictionary
             return {
@@ -332,6 +401,35 @@ class SecurityAnalyzer:
                 'analysis_summary': str(e)
             }
 
+    def native_metrics(self) -> Optional[Dict[str, Any]]:
+        """Per-stage latency and counters of the C++ analyzer, or None without it."""
+        if not self.cpp_analyzer or not hasattr(self.cpp_analyzer, 'get_metrics'):
+            return None
+        metrics = self.cpp_analyzer.get_metrics()
+        return {
+            'stages': {
+                name: {
+                    'count': stage.count,
+                    'total_ms': stage.total_ns / 1e6,
+                    'p50_ms': stage.percentile_ns(0.5) / 1e6,
+                    'p99_ms': stage.percentile_ns(0.99) / 1e6,
+                    'max_ms': stage.max_ns / 1e6,
+                }
+                for name, stage in metrics.stages.items()
+            },
+            'texts_analyzed': metrics.texts_analyzed,
+            'pdfs_analyzed': metrics.pdfs_analyzed,
+            'bytes_scanned': metrics.bytes_scanned,
+            'pages_extracted': metrics.pages_extracted,
+            'analyses_cut_short': metrics.analyses_cut_short,
+            'pii_found': {
+                'email': metrics.email_found,
+                'phone': metrics.phone_found,
+                'ssn': metrics.ssn_found,
+            },
+            'category_matches': dict(metrics.category_matches),
+        }
+
     def is_content_safe(self, content: str, threshold: float = 0.8) -> bool:
         """Checks if text content is safe using the Python analyzer."""
         result = self.analyze_text(content)
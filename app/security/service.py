@@ -11,6 +11,17 @@ from . import SecurityAnalyzer
 
 logger = logging.getLogger(__name__)
 
+# Every service shares one analyzer; security levels are profiles on it
+_shared_analyzer = None
+
+
+def _analyzer() -> SecurityAnalyzer:
+    global _shared_analyzer
+    if _shared_analyzer is None:
+        _shared_analyzer = SecurityAnalyzer()
+    return _shared_analyzer
+
+
 class SecurityService:
     """Service for security-related operations."""
     
@@ -20,15 +31,19 @@ class SecurityService:
         # Configure thresholds first
         self._setup_security_levels()
 
-        # Instantiate analyzer with threshold suited to this security level
-        self.analyzer = SecurityAnalyzer(threshold=self.config["threshold"])
+        # The shared analyzer applies this level's threshold as a named profile
+        self.analyzer = _analyzer()
+        self.analyzer.set_profile(self.security_level, threshold=self.config["threshold"])
+        # Uploads are also checked for PII, which text validation leaves out
+        self.file_profile = f"{self.security_level}_file"
+        self.analyzer.set_profile(self.file_profile, threshold=self.config["threshold"], detect_pii=True)
     
     def _setup_security_levels(self) -> None:
         """Configure security parameters based on the security level."""
         self.levels = {
-            "high": {"threshold": 0.9, "deep_analysis": True},
-            "medium": {"threshold": 0.7, "deep_analysis": False},
-            "low": {"threshold": 0.5, "deep_analysis": False},
+            "high": {"threshold": 0.9},
+            "medium": {"threshold": 0.7},
+            "low": {"threshold": 0.5},
         }
         
         if self.security_level not in self.levels:
@@ -43,7 +58,7 @@ class SecurityService:
             if not text or not text.strip():
                 return {"status": "unsafe", "reason": "empty_input", "overall_score": 0.0}
             
-            analysis = self.analyzer.analyze_text(text)
+            analysis = self.analyzer.analyze_text(text, profile_id=self.security_level)
             return self._process_analysis_results(analysis)
             
         except Exception as e:
@@ -91,7 +106,7 @@ class SecurityService:
                 temp_path = temp_file.name
             
             try:
-                analysis = self.analyzer.analyze_file(temp_path)
+                analysis = self.analyzer.analyze_file(temp_path, profile_id=self.file_profile)
                 return self._process_analysis_results(analysis)
             finally:
                 Path(temp_path).unlink(missing_ok=True)
@@ -101,15 +116,22 @@ class SecurityService:
             return {"status": "error", "reason": "validation_error", "error": str(e)}
 
     def _process_analysis_results(self, analysis: Any) -> Dict[str, Any]:
-        """Process the analysis results and calculate scores."""
+        """Report the analyzer's verdict; the native profile already applied this level's weights and threshold."""
+        # Text analysis reports both parts of its score; files get no LLM pass
         if isinstance(analysis, dict):
+            is_safe = analysis.get('is_safe', False)
             detected_issues = analysis.get('detected_issues', [])
-            confidence = analysis.get('confidence_score', 1.0)
+            confidence = analysis.get('confidence_score', 0.0)
             summary = analysis.get('analysis_summary', '')
+            rule_score = analysis.get('rule_score', confidence)
+            llm_score = analysis.get('llm_score', 1.0)
         else:
+            is_safe = analysis.is_safe
             detected_issues = analysis.detected_issues
             confidence = analysis.confidence_score
             summary = getattr(analysis, 'analysis_summary', '')
+            rule_score = confidence
+            llm_score = 1.0
 
         # Map issue types for backward compatibility
         mapped_issues = []
@@ -119,39 +141,21 @@ class SecurityService:
             else:
                 mapped_issues.append(issue)
 
-        if detected_issues:
-            return {
-                "status": "unsafe",
-                "reason": ", ".join(detected_issues),
-                "detected_issues": mapped_issues,
-                "analysis_summary": summary,
-                "llm_score": confidence if self.config["deep_analysis"] else 1.0,
-                "rule_score": 0.0,
-                "overall_score": 0.0,
-            }
-        
-        rule_score = 1.0
-        llm_score = confidence if self.config["deep_analysis"] else 1.0
-        
-        if self.security_level == "high":
-            overall_score = (rule_score * 0.4) + (llm_score * 0.6)
-        elif self.security_level == "medium":
-            overall_score = (rule_score * 0.7) + (llm_score * 0.3)
-        else:  # low
-            overall_score = rule_score
-        
-        is_safe = overall_score >= self.config["threshold"]
-
-        reason = "safe" if is_safe else "unspecified_issue"
+        if is_safe:
+            reason = "safe"
+        elif detected_issues:
+            reason = ", ".join(detected_issues)
+        else:
+            reason = "unspecified_issue"
 
         return {
             "status": "safe" if is_safe else "unsafe",
             "reason": reason,
-            "detected_issues": [],  # Empty list for safe content
+            "detected_issues": mapped_issues,
             "analysis_summary": summary,
             "llm_score": llm_score,
             "rule_score": rule_score,
-            "overall_score": overall_score,
+            "overall_score": confidence,
         }
 
 # Default security service instance
@@ -0,0 +1,104 @@
+"""
+Client for security_analyzer_server, the native analyzer run as one process per
+node and shared by every frontend worker over a Unix socket.
+The wire format is described in cpp/securityAnalyzer/IpcProtocol.h.
+"""
+import socket
+import struct
+import threading
+from typing import Any, Dict, Union
+
+_OP_PING = 0
+_OP_ANALYZE_TEXT = 1
+_OP_ANALYZE_PDF = 2
+_FLAG_SPANS = 1
+
+_REQUEST_HEADER = struct.Struct('<IIBBHI')
+_RESPONSE_HEADER = struct.Struct('<IBBHdI')
+_SPAN = struct.Struct('<BIQQI')
+
+
+class SidecarError(Exception):
+    pass
+
+
+class SidecarClient:
+    """One connection to the server; calls from several threads are serialized."""
+
+    def __init__(self, socket_path: str, timeout: float = 30.0):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.settimeout(timeout)
+        self._sock.connect(socket_path)
+        self._lock = threading.Lock()
+        self._next_id = 1
+
+    def close(self) -> None:
+        self._sock.close()
+
+    def ping(self) -> None:
+        self._call(_OP_PING, b'')
+
+    def analyze_text(self, text: Union[str, bytes], timeout_ms: int = 0, spans: bool = False) -> Dict[str, Any]:
+        data = text.encode('utf-8') if isinstance(text, str) else text
+        return self._call(_OP_ANALYZE_TEXT, data, timeout_ms, spans)
+
+    def analyze_pdf(self, data: bytes, timeout_ms: int = 0, spans: bool = False) -> Dict[str, Any]:
+        return self._call(_OP_ANALYZE_PDF, data, timeout_ms, spans)
+
+    def _call(self, op: int, payload: bytes, timeout_ms: int = 0, spans: bool = False) -> Dict[str, Any]:
+        with self._lock:
+            request_id = self._next_id
+            self._next_id = (self._next_id + 1) & 0xFFFFFFFF
+            header = _REQUEST_HEADER.pack(_REQUEST_HEADER.size - 4 + len(payload), request_id, op,
+                                          _FLAG_SPANS if spans else 0, 0, timeout_ms)
+            self._sock.sendall(header + payload)
+            (size,) = struct.unpack('<I', self._recv(4))
+            frame = self._recv(size)
+        return self._decode(request_id, frame)
+
+    def _recv(self, count: int) -> bytes:
+        chunks = []
+        while count:
+            chunk = self._sock.recv(min(count, 1 << 20))
+            if not chunk:
+                raise SidecarError('server closed the connection')
+            chunks.append(chunk)
+            count -= len(chunk)
+        return b''.join(chunks)
+
+    @staticmethod
+    def _decode(request_id: int, frame: bytes) -> Dict[str, Any]:
+        response_id, status, is_safe, _, score, pages = _RESPONSE_HEADER.unpack_from(frame)
+        if response_id != request_id:
+            raise SidecarError(f'response for request {response_id} while waiting for {request_id}')
+        pos = _RESPONSE_HEADER.size
+
+        def string() -> str:
+            nonlocal pos
+            (length,) = struct.unpack_from('<I', frame, pos)
+            pos += 4 + length
+            return frame[pos - length:pos].decode('utf-8', errors='replace')
+
+        (count,) = struct.unpack_from('<I', frame, pos)
+        pos += 4
+        issues = [string() for _ in range(count)]
+        (count,) = struct.unpack_from('<I', frame, pos)
+        pos += 4
+        spans = []
+        for _ in range(count):
+            kind, pattern_id, begin, end, page = _SPAN.unpack_from(frame, pos)
+            pos += _SPAN.size
+            spans.append({'kind': kind, 'pattern_id': pattern_id, 'begin': begin, 'end': end, 'page': page})
+        summary = string()
+        error = string()
+        if status != 0:
+            raise SidecarError(error or f'server status {status}')
+        return {
+            'is_safe': bool(is_safe),
+            'confidence_score': score,
+            'detected_issues': issues,
+            'analysis_summary': summary,
+            'pages_analyzed': pages,
+            'spans': spans,
+            'error': error,
+        }
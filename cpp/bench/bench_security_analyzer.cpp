@@ -0,0 +1,192 @@
+#include <benchmark/benchmark.h>
+#include "../securityAnalyzer/SecurityAnalyzer.h"
+#include "../securityAnalyzer/Ruleset.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Every heap allocation in the process is counted, so allocs_per_call shows
+// what one call costs beyond the bytes it scans
+static std::atomic<size_t> g_allocations{0};
+
+// The other forms of new (array, nothrow) end up in this one. GCC pairs
+// ::operator new with its own delete rather than with this replacement, so
+// once the delete is inlined the free below looks mismatched.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+struct DetectorBench {
+    static void detectPII(const SecurityAnalyzer& analyzer, std::string_view text, const Ruleset& rules) {
+        Findings findings;
+        analyzer.detectPII(text, rules, findings);
+        benchmark::DoNotOptimize(findings);
+    }
+    static void detectMaliciousContent(const SecurityAnalyzer& analyzer, std::string_view text,
+                                       const Ruleset& rules) {
+        Findings findings;
+        analyzer.detectMaliciousContent(text, rules, findings);
+        benchmark::DoNotOptimize(findings);
+    }
+};
+
+namespace {
+
+enum Corpus { CLEAN, PII_HEAVY, INJECTION_HEAVY };
+
+const char* const clean_text =
+    "The quarterly report covers revenue, hiring and the roadmap for the next release. "
+    "Teams met their targets and the migration finished ahead of schedule. ";
+const char* const pii_text =
+    "Contact jane.doe@example.com or call 555-234-5678 about claim 123-45-6789. "
+    "Backup: support@company.org, +1 212-555-0147. ";
+const char* const injection_text =
+    "name=' or 1=1-- <script>document.cookie</script> ; cat /etc/passwd "
+    "../../boot.ini $where: this.password union all select ";
+
+// Repeats the corpus seed up to size bytes
+const std::string& corpus(Corpus kind, size_t size) {
+    static std::string cache[3][3];
+    const size_t slot = size <= 1024 ? 0 : size <= 100 * 1024 ? 1 : 2;
+    std::string& text = cache[kind][slot];
+    if (text.empty()) {
+        const std::string seed = kind == CLEAN ? clean_text : kind == PII_HEAVY ? pii_text : injection_text;
+        text.reserve(size);
+        while (text.size() < size) {
+            text.append(seed, 0, std::min(seed.size(), size - text.size()));
+        }
+    }
+    return text;
+}
+
+// Same minimal layout as the test fixtures, one content stream per page
+std::vector<uint8_t> makePDF(int pages, const std::string& page_text) {
+    std::string kids;
+    for (int i = 0; i < pages; ++i) {
+        kids += std::to_string(3 + 2 * i) + " 0 R ";
+    }
+    std::string pdf = "%PDF-1.4\n1 0 obj << /Type /Catalog /Pages 2 0 R >> endobj\n"
+                      "2 0 obj << /Type /Pages /Count " + std::to_string(pages) + " /Kids [" + kids + "] >> endobj\n";
+    for (int i = 0; i < pages; ++i) {
+        const std::string stream = "BT /F1 12 Tf 10 100 Td (" + page_text + ") Tj ET";
+        pdf += std::to_string(3 + 2 * i) + " 0 obj << /Type /Page /Parent 2 0 R /MediaBox [0 0 300 144] /Contents " +
+               std::to_string(4 + 2 * i) + " 0 R >> endobj\n" + std::to_string(4 + 2 * i) + " 0 obj << /Length " +
+               std::to_string(stream.size()) + " >> stream\n" + stream + "\nendstream endobj\n";
+    }
+    pdf += "trailer << /Size " + std::to_string(3 + 2 * pages) + " /Root 1 0 R >>\n%%EOF";
+    return std::vector<uint8_t>(pdf.begin(), pdf.end());
+}
+
+// Sets bytes/sec and allocs_per_call; call after the timed loop
+void report(benchmark::State& state, size_t bytes_per_call, size_t allocations) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes_per_call));
+    state.counters["allocs_per_call"] =
+        benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+void BM_AnalyzeText(benchmark::State& state) {
+    const std::string& text = corpus(static_cast<Corpus>(state.range(0)), static_cast<size_t>(state.range(1)));
+    SecurityAnalyzer analyzer;
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzer.analyzeText(text));
+    }
+    report(state, text.size(), g_allocations.load() - before);
+}
+
+void BM_AnalyzeTextCached(benchmark::State& state) {
+    const std::string& text = corpus(static_cast<Corpus>(state.range(0)), static_cast<size_t>(state.range(1)));
+    SecurityAnalyzer analyzer(0.8, 0, 64 << 20);
+    analyzer.analyzeText(text);
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzer.analyzeText(text));
+    }
+    report(state, text.size(), g_allocations.load() - before);
+}
+
+void BM_DetectPII(benchmark::State& state) {
+    const std::string& text = corpus(static_cast<Corpus>(state.range(0)), static_cast<size_t>(state.range(1)));
+    SecurityAnalyzer analyzer;
+    const auto rules = analyzer.ruleset();
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        DetectorBench::detectPII(analyzer, text, *rules);
+    }
+    report(state, text.size(), g_allocations.load() - before);
+}
+
+void BM_DetectMaliciousContent(benchmark::State& state) {
+    const std::string& text = corpus(static_cast<Corpus>(state.range(0)), static_cast<size_t>(state.range(1)));
+    SecurityAnalyzer analyzer;
+    const auto rules = analyzer.ruleset();
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        DetectorBench::detectMaliciousContent(analyzer, text, *rules);
+    }
+    report(state, text.size(), g_allocations.load() - before);
+}
+
+// 64 documents of 100 KB, over range(0) workers
+void BM_AnalyzeBatch(benchmark::State& state) {
+    const std::string& text = corpus(PII_HEAVY, 100 * 1024);
+    const std::vector<std::string_view> texts(64, text);
+    SecurityAnalyzer analyzer(0.8, static_cast<size_t>(state.range(0)));
+    analyzer.analyzeBatch(texts);  // start the pool outside the timing
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzer.analyzeBatch(texts));
+    }
+    report(state, texts.size() * text.size(), g_allocations.load() - before);
+}
+
+// range(0) pages; range(1) != 0 lets the scan stop once the verdict is decided
+void BM_AnalyzePDF(benchmark::State& state) {
+    const int pages = static_cast<int>(state.range(0));
+    const auto pdf = makePDF(pages, corpus(CLEAN, 1024));
+    SecurityAnalyzer analyzer;
+    PDFScanOptions options;
+    options.stop_when_decided = state.range(1) != 0;
+    const size_t before = g_allocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzer.analyzePDF(pdf, options));
+    }
+    report(state, pdf.size(), g_allocations.load() - before);
+}
+
+void textSizes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({"corpus", "bytes"});
+    for (int corpus_kind : {CLEAN, PII_HEAVY, INJECTION_HEAVY}) {
+        for (int64_t size : {1024, 100 * 1024, 10 * 1024 * 1024}) {
+            bench->Args({corpus_kind, size});
+        }
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_AnalyzeText)->Apply(textSizes);
+BENCHMARK(BM_AnalyzeTextCached)->Apply(textSizes);
+BENCHMARK(BM_DetectPII)->Apply(textSizes);
+BENCHMARK(BM_DetectMaliciousContent)->Apply(textSizes);
+BENCHMARK(BM_AnalyzeBatch)->ArgName("workers")->Arg(1)->Arg(2)->Arg(4)->Arg(0)->UseRealTime();
+BENCHMARK(BM_AnalyzePDF)->ArgNames({"pages", "stop_when_decided"})->Args({1, 0})->Args({16, 0})->Args({128, 0})
+    ->Args({128, 1})->UseRealTime();
+
+BENCHMARK_MAIN();
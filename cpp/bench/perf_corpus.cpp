@@ -0,0 +1,446 @@
+#include "../securityAnalyzer/SecurityAnalyzer.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+namespace {
+
+// Bump when the generated documents change, so old corpora are rebuilt
+const int CORPUS_VERSION = 1;
+
+struct Document {
+    std::string name;
+    bool pdf = false;
+    int pages = 0;
+    std::string bytes;
+};
+
+const char* const words[] = {
+    "quarterly", "report", "revenue", "hiring", "roadmap", "release", "teams", "targets", "migration",
+    "schedule", "customer", "invoice", "budget", "review", "meeting", "summary", "project", "platform",
+    "service", "latency", "storage", "network", "policy", "contract", "the", "and", "of", "for", "with",
+    "a", "to", "in", "on", "ahead", "next", "finished", "approved", "pending", "draft", "final",
+};
+const char* const findings[] = {
+    "jane.doe@example.com", "555-234-5678", "123-45-6789", "' or 1=1--", "<script>document.cookie</script>",
+    "; cat /etc/passwd", "../../boot.ini", "$where: this.password", "union all select", "eval(atob(x))",
+};
+
+// Deterministic text from the seeded generator: prose words, with one of
+// the findings about every finding_every bytes (0 = never)
+std::string makeText(std::mt19937& rng, size_t size, size_t finding_every) {
+    std::uniform_int_distribution<size_t> word(0, std::size(words) - 1);
+    std::uniform_int_distribution<size_t> finding(0, std::size(findings) - 1);
+    std::string text;
+    text.reserve(size + 64);
+    size_t next_finding = finding_every;
+    while (text.size() < size) {
+        if (finding_every && text.size() >= next_finding) {
+            text += findings[finding(rng)];
+            next_finding += finding_every;
+        } else {
+            text += words[word(rng)];
+        }
+        text += text.size() % 97 < 8 ? ". " : " ";
+    }
+    text.resize(size);
+    return text;
+}
+
+std::string pdfString(std::string_view text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '(' || c == ')' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+// Same minimal layout as the test fixtures and the benchmarks, one content
+// stream per page. extra_objects are appended as objects after the pages,
+// and catalog_extra goes into the catalog dictionary.
+std::string makePDF(const std::vector<std::string>& page_texts, const std::string& catalog_extra = "",
+                    const std::vector<std::string>& extra_objects = {}) {
+    const int pages = static_cast<int>(page_texts.size());
+    std::string kids;
+    for (int i = 0; i < pages; ++i) {
+        kids += std::to_string(3 + 2 * i) + " 0 R ";
+    }
+    std::string pdf = "%PDF-1.4\n1 0 obj << /Type /Catalog /Pages 2 0 R " + catalog_extra + ">> endobj\n"
+                      "2 0 obj << /Type /Pages /Count " + std::to_string(pages) + " /Kids [" + kids + "] >> endobj\n";
+    for (int i = 0; i < pages; ++i) {
+        const std::string stream = "BT /F1 12 Tf 10 100 Td (" + pdfString(page_texts[i]) + ") Tj ET";
+        pdf += std::to_string(3 + 2 * i) + " 0 obj << /Type /Page /Parent 2 0 R /MediaBox [0 0 300 144] /Contents " +
+               std::to_string(4 + 2 * i) + " 0 R >> endobj\n" + std::to_string(4 + 2 * i) + " 0 obj << /Length " +
+               std::to_string(stream.size()) + " >> stream\n" + stream + "\nendstream endobj\n";
+    }
+    int id = 3 + 2 * pages;
+    for (const auto& object : extra_objects) {
+        pdf += std::to_string(id++) + " 0 obj " + object + " endobj\n";
+    }
+    pdf += "trailer << /Size " + std::to_string(id) + " /Root 1 0 R >>\n%%EOF";
+    return pdf;
+}
+
+std::vector<std::string> makePages(std::mt19937& rng, int pages, size_t page_size, size_t finding_every) {
+    std::vector<std::string> texts;
+    for (int i = 0; i < pages; ++i) {
+        texts.push_back(makeText(rng, page_size, finding_every));
+    }
+    return texts;
+}
+
+// The corpus is a function of seed and scale only, so every machine replays
+// the same bytes
+std::vector<Document> generateCorpus(uint32_t seed, double scale) {
+    std::mt19937 rng(seed);
+    auto scaled = [scale](size_t size) { return std::max<size_t>(1024, static_cast<size_t>(size * scale)); };
+    auto scaledPages = [scale](int pages) { return std::max(2, static_cast<int>(pages * scale)); };
+    std::vector<Document> corpus;
+
+    corpus.push_back({"text_clean_8mb", false, 0, makeText(rng, scaled(8 << 20), 0)});
+    corpus.push_back({"text_mixed_4mb", false, 0, makeText(rng, scaled(4 << 20), 16 * 1024)});
+    for (int i = 0; i < 32; ++i) {
+        corpus.push_back({"text_small_" + std::to_string(i), false, 0,
+                          makeText(rng, 2048 + 512 * static_cast<size_t>(i), i % 4 == 0 ? 1024 : 0)});
+    }
+
+    const int large_pages = scaledPages(400);
+    corpus.push_back({"pdf_large_" + std::to_string(large_pages) + "p", true, large_pages,
+                      makePDF(makePages(rng, large_pages, 3000, 0))});
+    for (int i = 0; i < 8; ++i) {
+        const int pages = scaledPages(24);
+        corpus.push_back({"pdf_multipage_" + std::to_string(i), true, pages,
+                          makePDF(makePages(rng, pages, 1500, i % 2 ? 4096 : 0))});
+    }
+
+    // An attachment in the EmbeddedFiles name tree; the pre-scan flags it
+    const int embedded_pages = 4;
+    const std::string attachment = makeText(rng, 4096, 512);
+    const int first_extra = 3 + 2 * embedded_pages;
+    corpus.push_back({"pdf_embedded_file", true, embedded_pages,
+                      makePDF(makePages(rng, embedded_pages, 1500, 0),
+                              "/Names << /EmbeddedFiles << /Names [(notes.txt) " + std::to_string(first_extra) +
+                                  " 0 R] >> >> ",
+                              {"<< /Type /Filespec /F (notes.txt) /EF << /F " + std::to_string(first_extra + 1) +
+                                   " 0 R >> >>",
+                               "<< /Type /EmbeddedFile /Length " + std::to_string(attachment.size()) +
+                                   " >> stream\n" + attachment + "\nendstream"})});
+
+    // Malformed: cut off mid-stream, a wrong stream length, a broken header
+    // and a page tree pointing at objects that do not exist
+    const std::string whole = makePDF(makePages(rng, 16, 1500, 0));
+    corpus.push_back({"pdf_truncated", true, 16, whole.substr(0, whole.size() / 2)});
+    std::string bad_length = whole;
+    const size_t length_at = bad_length.find("/Length ");
+    bad_length.replace(length_at, 12, "/Length 9999");
+    corpus.push_back({"pdf_bad_stream_length", true, 16, bad_length});
+    corpus.push_back({"pdf_bad_header", true, 16, "%PDF-9" + whole.substr(8)});
+    corpus.push_back({"pdf_dangling_pages", true, 64,
+                      "%PDF-1.4\n1 0 obj << /Type /Catalog /Pages 2 0 R >> endobj\n"
+                      "2 0 obj << /Type /Pages /Count 64 /Kids [90 0 R 91 0 R] >> endobj\n"
+                      "trailer << /Size 3 /Root 1 0 R >>\n%%EOF"});
+    return corpus;
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("cannot read " + path.string());
+    }
+    std::ostringstream out;
+    out << file.rdbuf();
+    return out.str();
+}
+
+void writeFile(const fs::path& path, std::string_view bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file.flush()) {
+        throw std::runtime_error("cannot write " + path.string());
+    }
+}
+
+// Reads the corpus from dir through its index.json, first writing it there
+// if the index is missing or was made with another version, seed or scale
+std::vector<Document> loadCorpus(const fs::path& dir, uint32_t seed, double scale) {
+    const fs::path index_path = dir / "index.json";
+    if (fs::exists(index_path)) {
+        const json index = json::parse(readFile(index_path));
+        if (index.value("version", 0) == CORPUS_VERSION && index.value("seed", 0u) == seed &&
+            index.value("scale", 0.0) == scale) {
+            std::vector<Document> corpus;
+            for (const auto& entry : index.at("documents")) {
+                corpus.push_back({entry.at("name").get<std::string>(), entry.at("kind") == "pdf",
+                                  entry.at("pages").get<int>(),
+                                  readFile(dir / entry.at("file").get<std::string>())});
+            }
+            return corpus;
+        }
+    }
+
+    std::vector<Document> corpus = generateCorpus(seed, scale);
+    fs::create_directories(dir);
+    json documents = json::array();
+    for (const auto& document : corpus) {
+        const std::string file = document.name + (document.pdf ? ".pdf" : ".txt");
+        writeFile(dir / file, document.bytes);
+        documents.push_back({{"name", document.name}, {"kind", document.pdf ? "pdf" : "text"},
+                             {"file", file}, {"bytes", document.bytes.size()}, {"pages", document.pages}});
+    }
+    const json index = {{"version", CORPUS_VERSION}, {"seed", seed}, {"scale", scale}, {"documents", documents}};
+    writeFile(index_path, index.dump(2));
+    return corpus;
+}
+
+// getrusage's ru_maxrss is the high-water mark of the whole process, the
+// same for every run after the warm-up. Linux keeps a resettable one,
+// VmHWM, which gives each run its own peak.
+bool resetPeakRss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    return static_cast<bool>(clear_refs << "5") && static_cast<bool>(clear_refs.flush());
+}
+
+// Peak RSS since the last resetPeakRss(), or of the process without one
+double peakRssMb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::strtod(line.c_str() + 6, nullptr) / 1024.0;  // in kB
+        }
+    }
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) / 1024.0;  // ru_maxrss is in KB on Linux
+}
+
+void analyze(const SecurityAnalyzer& analyzer, const Document& document) {
+    if (document.pdf) {
+        analyzer.analyzePDF(ByteView(reinterpret_cast<const uint8_t*>(document.bytes.data()), document.bytes.size()));
+    } else {
+        analyzer.analyzeText(document.bytes);
+    }
+}
+
+// Every document iterations times, shared out among threads caller threads.
+// The run's own peak RSS is recorded where it can be measured apart.
+json replay(const SecurityAnalyzer& analyzer, const std::vector<Document>& corpus, size_t threads,
+            int iterations) {
+    const bool own_peak = resetPeakRss();
+    const size_t total = corpus.size() * static_cast<size_t>(iterations);
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<double>> latencies(threads);
+    auto worker = [&](size_t t) {
+        for (size_t i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+            const auto start = std::chrono::steady_clock::now();
+            analyze(analyzer, corpus[i % corpus.size()]);
+            latencies[t].push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto& part : latencies) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+    size_t bytes = 0;
+    for (const auto& document : corpus) {
+        bytes += document.bytes.size();
+    }
+    json run = {{"threads", threads},
+                {"docs_per_sec", static_cast<double>(total) / seconds},
+                {"mb_per_sec", static_cast<double>(bytes) * iterations / (1024.0 * 1024.0) / seconds},
+                {"p50_ms", percentile(0.50)},
+                {"p99_ms", percentile(0.99)}};
+    if (own_peak) {
+        run["peak_rss_mb"] = peakRssMb();
+    }
+    return run;
+}
+
+// Names each metric of report that is worse than baseline by more than
+// margin; throughput must not drop, latency and memory must not grow
+std::vector<std::string> regressions(const json& report, const json& baseline, double margin) {
+    std::vector<std::string> found;
+    auto check = [&](const std::string& where, const std::string& metric, double value, double base,
+                     bool higher_is_better) {
+        const bool worse = higher_is_better ? value < base * (1.0 - margin) : value > base * (1.0 + margin);
+        if (worse && base > 0.0) {
+            std::ostringstream line;
+            line << where << " " << metric << " " << value << " vs baseline " << base << " ("
+                 << (value / base - 1.0) * 100.0 << "%)";
+            found.push_back(line.str());
+        }
+    };
+    for (const auto& run : report.at("runs")) {
+        for (const auto& base : baseline.at("runs")) {
+            if (base.at("threads") != run.at("threads")) {
+                continue;
+            }
+            const std::string where = "threads=" + run.at("threads").dump();
+            check(where, "docs_per_sec", run.at("docs_per_sec"), base.at("docs_per_sec"), true);
+            check(where, "mb_per_sec", run.at("mb_per_sec"), base.at("mb_per_sec"), true);
+            check(where, "p50_ms", run.at("p50_ms"), base.at("p50_ms"), false);
+            check(where, "p99_ms", run.at("p99_ms"), base.at("p99_ms"), false);
+            if (run.contains("peak_rss_mb") && base.contains("peak_rss_mb")) {
+                check(where, "peak_rss_mb", run.at("peak_rss_mb"), base.at("peak_rss_mb"), false);
+            }
+        }
+    }
+    check("process", "peak_rss_mb", report.at("peak_rss_mb"), baseline.value("peak_rss_mb", 0.0), false);
+    return found;
+}
+
+void usage(const char* program) {
+    std::cerr << "usage: " << program << " [--corpus DIR] [--report FILE] [--baseline FILE] [--margin F]\n"
+              << "       [--require-baseline] [--threads N] [--iterations N] [--seed N] [--scale F]\n"
+              << "       [--pdf-workers N]\n";
+}
+
+} // namespace
+
+// Replays a generated corpus of large, multi-page, embedded-file and
+// malformed PDFs plus multi-MB texts across 1..N caller threads, writes
+// throughput, latency and peak RSS to a JSON report, and exits 1 when a
+// number regresses past the margin against the baseline report. Baselines
+// are per machine, so none ships with the tree: a missing one is not an
+// error unless --require-baseline is given (as on a CI host that keeps
+// its own); copy a report there to set one.
+int main(int argc, char** argv) {
+    fs::path corpus_dir = "perf_corpus";
+    fs::path report_path = "perf_report.json";
+    fs::path baseline_path;
+    double margin = 0.10;
+    bool require_baseline = false;
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    int iterations = 3;
+    uint32_t seed = 42;
+    double scale = 1.0;
+    size_t pdf_workers = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--corpus" && has_value) {
+            corpus_dir = argv[++i];
+        } else if (arg == "--report" && has_value) {
+            report_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--require-baseline") {
+            require_baseline = true;
+        } else if (arg == "--margin" && has_value) {
+            margin = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--threads" && has_value) {
+            max_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--iterations" && has_value) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && has_value) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--scale" && has_value) {
+            scale = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--pdf-workers" && has_value) {
+            pdf_workers = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    try {
+        const std::vector<Document> corpus = loadCorpus(corpus_dir, seed, scale);
+        size_t corpus_bytes = 0;
+        for (const auto& document : corpus) {
+            corpus_bytes += document.bytes.size();
+        }
+        // The threads sharing one analyzer are what scales here, so the pool
+        // behind multi-page extraction stays small by default
+        SecurityAnalyzer analyzer(0.8, pdf_workers);
+        for (const auto& document : corpus) {
+            analyze(analyzer, document);  // warm up: pool, page cache, allocator
+        }
+
+        // Read before the runs reset the high-water mark
+        double process_peak = peakRssMb();
+        json runs = json::array();
+        for (size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+            runs.push_back(replay(analyzer, corpus, threads, iterations));
+            const json& run = runs.back();
+            process_peak = std::max(process_peak, run.value("peak_rss_mb", 0.0));
+            std::cout << "threads " << threads << ": " << run["docs_per_sec"].get<double>() << " docs/s, "
+                      << run["mb_per_sec"].get<double>() << " MB/s, p50 " << run["p50_ms"].get<double>()
+                      << " ms, p99 " << run["p99_ms"].get<double>() << " ms\n";
+            if (threads == max_threads) {
+                break;
+            }
+        }
+        const json report = {{"corpus", {{"version", CORPUS_VERSION}, {"seed", seed}, {"scale", scale},
+                                         {"documents", corpus.size()}, {"bytes", corpus_bytes}}},
+                             {"iterations", iterations},
+                             {"runs", runs},
+                             {"peak_rss_mb", std::max(process_peak, peakRssMb())}};
+        writeFile(report_path, report.dump(2));
+        std::cout << "Wrote " << report_path.string() << "\n";
+
+        if (baseline_path.empty() || !fs::exists(baseline_path)) {
+            if (require_baseline) {
+                std::cerr << "perf_corpus: no baseline"
+                          << (baseline_path.empty() ? " given" : " at " + baseline_path.string()) << "\n";
+                return 1;
+            }
+            if (!baseline_path.empty()) {
+                std::cout << "No baseline at " << baseline_path.string() << "; copy the report there to set one\n";
+            }
+            return 0;
+        }
+        const json baseline = json::parse(readFile(baseline_path));
+        if (baseline.at("corpus") != report.at("corpus")) {
+            std::cerr << "perf_corpus: baseline was measured on another corpus\n";
+            return 1;
+        }
+        const auto found = regressions(report, baseline, margin);
+        for (const auto& line : found) {
+            std::cerr << "REGRESSION " << line << "\n";
+        }
+        if (!found.empty()) {
+            return 1;
+        }
+        std::cout << "Within " << margin * 100.0 << "% of " << baseline_path.string() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "perf_corpus: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
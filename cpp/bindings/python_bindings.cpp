@@ -1,32 +1,525 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include "../securityAnalyzer/SecurityAnalyzer.h"
+#include "../securityAnalyzer/Ruleset.h"
+#include "../securityAnalyzer/RulesetDirectory.h"
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace py = pybind11;
 
+namespace {
+
+// Read-only view of a contiguous Python buffer (bytes, bytearray, memoryview,
+// mmap, ...). Holds the buffer export for its lifetime, so it must be created
+// and destroyed with the GIL held.
+class BufferView {
+public:
+    explicit BufferView(const py::buffer& buffer) {
+        if (PyObject_GetBuffer(buffer.ptr(), &view_, PyBUF_SIMPLE) != 0) {
+            throw py::error_already_set();
+        }
+    }
+    ~BufferView() { PyBuffer_Release(&view_); }
+
+    BufferView(const BufferView&) = delete;
+    BufferView& operator=(const BufferView&) = delete;
+
+    std::string_view text() const {
+        return {static_cast<const char*>(view_.buf), static_cast<size_t>(view_.len)};
+    }
+    ByteView bytes() const {
+        return {static_cast<const uint8_t*>(view_.buf), static_cast<size_t>(view_.len)};
+    }
+
+private:
+    Py_buffer view_;
+};
+
+// Results of the async analyses started on one asyncio loop. Workers queue
+// them and signal an eventfd the loop watches, so finishing an analysis never
+// takes the GIL; the loop's reader then resolves the futures.
+class AsyncCompletions {
+public:
+    AsyncCompletions() : fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot create eventfd");
+        }
+    }
+    ~AsyncCompletions() { ::close(fd_); }
+
+    AsyncCompletions(const AsyncCompletions&) = delete;
+    AsyncCompletions& operator=(const AsyncCompletions&) = delete;
+
+    int fd() const { return fd_; }
+    // With the GIL held
+    uint64_t nextId() { return next_id_++; }
+
+    // From any thread
+    void push(uint64_t id, AnalysisResult result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.emplace_back(id, std::move(result));
+        }
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = ::write(fd_, &one, sizeof(one));
+    }
+
+    std::vector<std::pair<uint64_t, AnalysisResult>> take() {
+        uint64_t count;
+        [[maybe_unused]] ssize_t got = ::read(fd_, &count, sizeof(count));
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::exchange(done_, {});
+    }
+
+private:
+    const int fd_;
+    uint64_t next_id_ = 0;
+    std::mutex mutex_;
+    std::vector<std::pair<uint64_t, AnalysisResult>> done_;
+};
+
+// The completions of the running loop, created and hooked up to the loop's
+// reader on first use. Each carries a dict of its pending asyncio futures.
+py::object loopCompletions(const py::object& loop) {
+    py::object loops = py::module_::import("security_analyzer").attr("_async_loops");
+    py::object entry = loops.attr("get")(loop);
+    if (!entry.is_none()) {
+        return entry;
+    }
+    auto completions = std::make_shared<AsyncCompletions>();
+    py::dict pending;
+    entry = py::cast(completions);
+    entry.attr("pending") = pending;
+    loop.attr("add_reader")(completions->fd(), py::cpp_function([completions, pending]() {
+        for (auto& done : completions->take()) {
+            py::object future = pending.attr("pop")(done.first, py::none());
+            // A cancelled future is already done and takes no result
+            if (!future.is_none() && !future.attr("done")().cast<bool>()) {
+                future.attr("set_result")(py::cast(std::move(done.second)));
+            }
+        }
+    }));
+    loops[loop] = entry;
+    return entry;
+}
+
+// Starts an analysis on the native pool and returns an asyncio future for it.
+// The input is copied once, so no worker ever touches a Python object, and
+// cancelling the future cancels the analysis.
+py::object analyzeOnLoop(const SecurityAnalyzer& analyzer, const py::object& data, bool pdf,
+                         std::optional<AnalysisOptions> limits) {
+    py::object loop = py::module_::import("asyncio").attr("get_running_loop")();
+    py::object entry = loopCompletions(loop);
+    auto completions = entry.cast<std::shared_ptr<AsyncCompletions>>();
+
+    auto owned = std::make_shared<std::string>();
+    if (py::isinstance<py::str>(data)) {
+        *owned = data.cast<std::string>();
+    } else {
+        BufferView view(py::reinterpret_borrow<py::buffer>(data));
+        owned->assign(view.text());
+    }
+
+    py::object future = loop.attr("create_future")();
+    const uint64_t id = completions->nextId();
+    entry.attr("pending")[py::int_(id)] = future;
+
+    AnalysisOptions options = limits ? *std::move(limits) : AnalysisOptions();
+    if (!options.cancel) {
+        auto token = std::make_shared<CancellationToken>();
+        options.cancel = token;
+        future.attr("add_done_callback")(py::cpp_function([token](const py::object& done) {
+            if (done.attr("cancelled")().cast<bool>()) {
+                token->cancel();
+            }
+        }));
+    }
+    auto on_done = [completions, id, owned](AnalysisResult result) { completions->push(id, std::move(result)); };
+    if (pdf) {
+        analyzer.analyzePDFAsync(ByteView(reinterpret_cast<const uint8_t*>(owned->data()), owned->size()),
+                                 options, std::move(on_done));
+    } else {
+        analyzer.analyzeAsync(*owned, options, std::move(on_done));
+    }
+    return future;
+}
+
+} // namespace
+
 PYBIND11_MODULE(security_analyzer, m) {
     m.doc() = "Python bindings for the Security Analyzer";
 
+    py::class_<PDFStructure>(m, "PDFStructure")
+        .def_readonly("javascript", &PDFStructure::javascript)
+        .def_readonly("open_action", &PDFStructure::open_action)
+        .def_readonly("launch", &PDFStructure::launch)
+        .def_readonly("embedded_file", &PDFStructure::embedded_file)
+        .def_readonly("additional_actions", &PDFStructure::additional_actions)
+        .def_readonly("object_count", &PDFStructure::object_count)
+        .def_readonly("xref_valid", &PDFStructure::xref_valid)
+        .def_readonly("has_eof", &PDFStructure::has_eof);
+
+    py::enum_<IssueKind>(m, "IssueKind")
+        .value("PII", ISSUE_PII)
+        .value("EMAIL", ISSUE_EMAIL)
+        .value("PHONE", ISSUE_PHONE)
+        .value("SSN", ISSUE_SSN)
+        .value("PATTERN", ISSUE_PATTERN)
+        .value("FILE_TOO_LARGE", ISSUE_FILE_TOO_LARGE)
+        .value("INVALID_PDF", ISSUE_INVALID_PDF)
+        .value("PDF_JAVASCRIPT", ISSUE_PDF_JAVASCRIPT)
+        .value("PDF_LAUNCH", ISSUE_PDF_LAUNCH)
+        .value("PDF_EMBEDDED_FILES", ISSUE_PDF_EMBEDDED_FILES)
+        .value("PDF_BUDGET_EXHAUSTED", ISSUE_PDF_BUDGET_EXHAUSTED)
+        .value("ANALYSIS_TIMEOUT", ISSUE_ANALYSIS_TIMEOUT)
+        .value("ANALYSIS_CANCELLED", ISSUE_ANALYSIS_CANCELLED)
+        .value("ERROR", ISSUE_ERROR);
+
+    py::class_<Issue>(m, "Issue")
+        .def_readonly("kind", &Issue::kind)
+        .def_readonly("pattern_id", &Issue::pattern_id)
+        .def_readonly("page", &Issue::page);
+
+    // begin/end are byte offsets into the UTF-8 encoding of the analyzed text
+    py::class_<Span>(m, "Span")
+        .def_readonly("kind", &Span::kind)
+        .def_readonly("pattern_id", &Span::pattern_id)
+        .def_readonly("begin", &Span::begin)
+        .def_readonly("end", &Span::end)
+        .def_readonly("page", &Span::page);
+
+    m.def("redact", [](py::bytes text, const std::vector<Span>& spans, char mask) {
+        const std::string_view view = text;
+        std::string out;
+        {
+            py::gil_scoped_release release;
+            out = redact(view, spans, mask);
+        }
+        return py::bytes(out);
+    }, "Mask every span of the UTF-8 bytes they were found in", py::arg("text"), py::arg("spans"),
+       py::arg("mask") = '*');
+
+    // Issue texts are rendered from the compact records on access only
     py::class_<AnalysisResult>(m, "AnalysisResult")
         .def_readonly("is_safe", &AnalysisResult::is_safe)
         .def_readonly("confidence_score", &AnalysisResult::confidence_score)
-        .def_readonly("detected_issues", &AnalysisResult::detected_issues)
-        .def_readonly("analysis_summary", &AnalysisResult::analysis_summary);
+        .def_property_readonly("detected_issues", &AnalysisResult::detectedIssues)
+        .def_readonly("issues", &AnalysisResult::issues)
+        .def("describe_issue", &AnalysisResult::describeIssue, py::arg("issue"))
+        .def_readonly("analysis_summary", &AnalysisResult::analysis_summary)
+        .def_property_readonly("issue_pages", &AnalysisResult::issuePages)
+        .def_readonly("spans", &AnalysisResult::spans)
+        .def_readonly("pages_analyzed", &AnalysisResult::pages_analyzed)
+        .def_readonly("pdf_structure", &AnalysisResult::pdf_structure);
+
+    py::class_<CacheStats>(m, "CacheStats")
+        .def_readonly("hits", &CacheStats::hits)
+        .def_readonly("misses", &CacheStats::misses)
+        .def_readonly("entries", &CacheStats::entries)
+        .def_readonly("bytes", &CacheStats::bytes);
+
+    py::enum_<MetricStage>(m, "MetricStage")
+        .value("ANALYZE_TEXT", STAGE_ANALYZE_TEXT)
+        .value("ANALYZE_PDF", STAGE_ANALYZE_PDF)
+        .value("PDF_STRUCTURE", STAGE_PDF_STRUCTURE)
+        .value("LOAD_PDF", STAGE_LOAD_PDF)
+        .value("EXTRACT_TEXT", STAGE_EXTRACT_TEXT)
+        .value("DETECT_PII", STAGE_DETECT_PII)
+        .value("DETECT_MALICIOUS", STAGE_DETECT_MALICIOUS);
+
+    py::class_<StageMetrics>(m, "StageMetrics")
+        .def_readonly("count", &StageMetrics::count)
+        .def_readonly("total_ns", &StageMetrics::total_ns)
+        .def_readonly("max_ns", &StageMetrics::max_ns)
+        .def_readonly("buckets", &StageMetrics::buckets)
+        .def("percentile_ns", &StageMetrics::percentileNs, py::arg("q"));
+
+    py::class_<MetricsSnapshot>(m, "MetricsSnapshot")
+        .def_property_readonly("stages", [](const MetricsSnapshot& self) {
+            py::dict stages;
+            for (size_t s = 0; s < STAGE_COUNT; ++s) {
+                stages[stageName(static_cast<MetricStage>(s))] = self.stages[s];
+            }
+            return stages;
+        }, "StageMetrics by stage name")
+        .def_readonly("texts_analyzed", &MetricsSnapshot::texts_analyzed)
+        .def_readonly("pdfs_analyzed", &MetricsSnapshot::pdfs_analyzed)
+        .def_readonly("bytes_scanned", &MetricsSnapshot::bytes_scanned)
+        .def_readonly("pages_extracted", &MetricsSnapshot::pages_extracted)
+        .def_readonly("email_found", &MetricsSnapshot::email_found)
+        .def_readonly("phone_found", &MetricsSnapshot::phone_found)
+        .def_readonly("ssn_found", &MetricsSnapshot::ssn_found)
+        .def_readonly("analyses_cut_short", &MetricsSnapshot::analyses_cut_short)
+        .def_readonly("category_matches", &MetricsSnapshot::category_matches);
+
+    py::class_<RuleCategory>(m, "RuleCategory")
+        .def(py::init<>())
+        .def_readwrite("issue", &RuleCategory::issue)
+        .def_readwrite("report_each_pattern", &RuleCategory::report_each_pattern)
+        .def_readwrite("case_sensitive", &RuleCategory::case_sensitive)
+        .def_readwrite("patterns", &RuleCategory::patterns)
+        .def_readwrite("whole_word", &RuleCategory::whole_word)
+        .def_readwrite("weight", &RuleCategory::weight)
+        .def_readwrite("pattern_weights", &RuleCategory::pattern_weights);
+
+    m.attr("KEYWORD_ISSUE") = KEYWORD_ISSUE;
+    m.def("load_rule_categories", &loadRuleCategories,
+          "Read rule categories from a JSON keyword list or category file", py::arg("path"));
+
+    py::class_<Ruleset, std::shared_ptr<Ruleset>>(m, "Ruleset")
+        .def_static("builtin", []() { return std::const_pointer_cast<Ruleset>(Ruleset::builtin()); },
+                    "The rules shipped with the library")
+        .def_static("compile", [](std::vector<RuleCategory> categories) {
+            return std::const_pointer_cast<Ruleset>(Ruleset::compile(std::move(categories)));
+        }, "Compile a list of RuleCategory into a ruleset", py::arg("categories"),
+           py::call_guard<py::gil_scoped_release>())
+        .def_static("load", [](const std::vector<std::string>& rule_files) {
+            return std::const_pointer_cast<Ruleset>(Ruleset::load(rule_files));
+        }, "Compile the built-in rules plus the categories in each JSON rule file", py::arg("rule_files"),
+           py::call_guard<py::gil_scoped_release>())
+        .def_static("open", [](const std::string& path) {
+            return std::const_pointer_cast<Ruleset>(Ruleset::open(path));
+        }, "Map a ruleset file written by save() without rebuilding its automata", py::arg("path"),
+           py::call_guard<py::gil_scoped_release>())
+        .def("save", &Ruleset::save, "Write the compiled rules to a file for Ruleset.open", py::arg("path"),
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("version", &Ruleset::version)
+        .def_property_readonly("pattern_count", &Ruleset::patternCount);
+
+    py::class_<CancellationToken, std::shared_ptr<CancellationToken>>(m, "CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &CancellationToken::cancel, "Stop every analysis given this token at its next check")
+        .def_property_readonly("cancelled", &CancellationToken::cancelled);
+
+    py::class_<AnalysisOptions>(m, "AnalysisOptions")
+        .def(py::init([](int64_t timeout_ms, uint64_t max_bytes_scanned, std::shared_ptr<CancellationToken> cancel) {
+            AnalysisOptions options = timeout_ms > 0 ? AnalysisOptions::withTimeout(std::chrono::milliseconds(timeout_ms))
+                                                     : AnalysisOptions();
+            options.max_bytes_scanned = max_bytes_scanned;
+            options.cancel = std::move(cancel);
+            return options;
+        }), "Limits for one analysis: a timeout from now (0 = none), bytes to scan (0 = unlimited) and a token",
+           py::arg("timeout_ms") = 0, py::arg("max_bytes_scanned") = 0, py::arg("cancel") = nullptr)
+        .def_readwrite("max_bytes_scanned", &AnalysisOptions::max_bytes_scanned);
+
+    py::class_<AnalysisProfile>(m, "AnalysisProfile")
+        .def(py::init([](double threshold, std::vector<std::string> categories,
+                         std::unordered_map<std::string, double> weights, bool detect_pii) {
+            return AnalysisProfile{threshold, std::move(categories), std::move(weights), detect_pii};
+        }), "A named policy: threshold, rule categories to run (by issue text; empty = all), "
+            "per-category weights and whether to look for PII",
+           py::arg("threshold") = 0.8, py::arg("categories") = std::vector<std::string>(),
+           py::arg("weights") = std::unordered_map<std::string, double>(), py::arg("detect_pii") = true)
+        .def_readwrite("threshold", &AnalysisProfile::threshold)
+        .def_readwrite("categories", &AnalysisProfile::categories)
+        .def_readwrite("weights", &AnalysisProfile::weights)
+        .def_readwrite("detect_pii", &AnalysisProfile::detect_pii);
+
+    // Per asyncio loop completion queues, dropped with their loop
+    m.attr("_async_loops") = py::module_::import("weakref").attr("WeakKeyDictionary")();
+    py::class_<AsyncCompletions, std::shared_ptr<AsyncCompletions>>(m, "_AsyncCompletions", py::dynamic_attr());
 
     py::class_<SecurityAnalyzer>(m, "SecurityAnalyzer")
-        .def(py::init<double>(), py::arg("threshold") = 0.8,
-             "Create a SecurityAnalyzer with an optional safety threshold")
+        .def(py::init<double, size_t, size_t>(), py::arg("threshold") = 0.8, py::arg("worker_threads") = 0,
+             py::arg("cache_bytes") = 0,
+             "Create a SecurityAnalyzer with an optional safety threshold, batch worker count (0 = all cores) "
+             "and result cache size in bytes (0 = no cache)")
         .def("set_threshold", &SecurityAnalyzer::setThreshold,
              "Set the safety threshold")
         .def("get_threshold", &SecurityAnalyzer::getThreshold,
              "Get the current safety threshold")
-        .def("analyze_text", &SecurityAnalyzer::analyzeText, "Analyzes a string of text for security vulnerabilities")
-        .def("analyze_pdf", [](SecurityAnalyzer& self, const std::vector<uint8_t>& data) {
+        // pybind11 holders cannot be shared_ptr<const T>; Ruleset exposes no
+        // mutators, so the const_cast never allows a write
+        .def("set_ruleset", [](SecurityAnalyzer& self, std::shared_ptr<Ruleset> ruleset) {
+            self.setRuleset(std::move(ruleset));
+        }, "Replace the detection rules; calls already running keep their rules", py::arg("ruleset"))
+        .def("ruleset", [](const SecurityAnalyzer& self) {
+            return std::const_pointer_cast<Ruleset>(self.ruleset());
+        }, "The detection rules in use")
+        .def("set_profile", &SecurityAnalyzer::setProfile,
+             "Add or replace a named profile for analyze_text, analyze_pdf and analyze_file",
+             py::arg("profile_id"), py::arg("profile"))
+        .def("remove_profile", &SecurityAnalyzer::removeProfile,
+             "Remove a named profile; False if there was none", py::arg("profile_id"))
+        // Arguments are converted while holding the GIL; the scan itself runs
+        // without it so other Python threads keep going during long documents.
+        // str and bytes arrive as std::string_view into the Python object and
+        // other bytes-like objects are read through the buffer protocol, so
+        // no input is copied.
+        .def("analyze_text", py::overload_cast<std::string_view>(&SecurityAnalyzer::analyzeText, py::const_),
+             "Analyzes a string of text for security vulnerabilities",
+             py::arg("text"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_text", [](const SecurityAnalyzer& self, const py::buffer& text) {
+            BufferView view(text);
+            py::gil_scoped_release release;
+            return self.analyzeText(view.text());
+        }, "Analyze text held in a bytes-like object without copying it",
+           py::arg("text"))
+        .def("analyze_text",
+             py::overload_cast<std::string_view, const AnalysisOptions&>(&SecurityAnalyzer::analyzeText, py::const_),
+             "Analyze text within the given limits; a cut-short result is unsafe and names the limit hit",
+             py::arg("text"), py::arg("limits"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_text", [](const SecurityAnalyzer& self, const py::buffer& text, const AnalysisOptions& limits) {
+            BufferView view(text);
+            py::gil_scoped_release release;
+            return self.analyzeText(view.text(), limits);
+        }, "Analyze text held in a bytes-like object within the given limits",
+           py::arg("text"), py::arg("limits"))
+        .def("analyze_text",
+             py::overload_cast<std::string_view, const std::string&>(&SecurityAnalyzer::analyzeText, py::const_),
+             "Analyze text under a profile from set_profile",
+             py::arg("text"), py::arg("profile_id"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_text",
+             py::overload_cast<std::string_view, const std::string&, const AnalysisOptions&>(
+                 &SecurityAnalyzer::analyzeText, py::const_),
+             "Analyze text under a profile from set_profile, within the given limits",
+             py::arg("text"), py::arg("profile_id"), py::arg("limits"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_text_spans", py::overload_cast<std::string_view>(&SecurityAnalyzer::analyzeTextSpans, py::const_),
+             "Analyze text and report where each finding was matched",
+             py::arg("text"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_text_spans", [](const SecurityAnalyzer& self, const py::buffer& text) {
+            BufferView view(text);
+            py::gil_scoped_release release;
+            return self.analyzeTextSpans(view.text());
+        }, "Analyze text held in a bytes-like object and report where each finding was matched",
+           py::arg("text"))
+        .def("analyze_pdf", [](const SecurityAnalyzer& self, const py::buffer& data) {
+            BufferView view(data);
+            py::gil_scoped_release release;
+            return self.analyzePDF(view.bytes());
+        }, "Analyze PDF data (bytes, bytearray, memoryview) for security issues without copying it",
+           py::arg("data"))
+        .def("analyze_pdf", [](const SecurityAnalyzer& self, const py::buffer& data, const AnalysisOptions& limits) {
+            PDFScanOptions full;
+            full.stop_when_decided = false;
+            BufferView view(data);
+            py::gil_scoped_release release;
+            return self.analyzePDF(view.bytes(), full, limits);
+        }, "Analyze PDF data within the given limits; a cut-short result is unsafe and names the limit hit",
+           py::arg("data"), py::arg("limits"))
+        .def("analyze_pdf", [](const SecurityAnalyzer& self, const py::buffer& data, const std::string& profile_id) {
+            BufferView view(data);
+            py::gil_scoped_release release;
+            return self.analyzePDF(view.bytes(), profile_id);
+        }, "Analyze PDF data under a profile from set_profile",
+           py::arg("data"), py::arg("profile_id"))
+        .def("analyze_pdf_incremental", [](const SecurityAnalyzer& self, const py::buffer& data,
+                                           int max_pages, int64_t time_budget_ms, bool stop_when_decided,
+                                           bool collect_spans) {
+            PDFScanOptions options;
+            options.stop_when_decided = stop_when_decided;
+            options.collect_spans = collect_spans;
+            options.max_pages = max_pages;
+            options.time_budget = std::chrono::milliseconds(time_budget_ms);
+            BufferView view(data);
+            py::gil_scoped_release release;
+            return self.analyzePDF(view.bytes(), options);
+        }, "Analyze a PDF page by page, stopping once the verdict is decided or a page/time budget (0 = unlimited) runs out",
+           py::arg("data"), py::arg("max_pages") = 0, py::arg("time_budget_ms") = 0,
+           py::arg("stop_when_decided") = true, py::arg("collect_spans") = false)
+        .def("analyze_pdf", [](const SecurityAnalyzer& self, const std::vector<uint8_t>& data) {
             return self.analyzePDF(data);
-        }, "Analyze PDF data for security issues")
+        }, "Analyze PDF data given as a sequence of byte values",
+           py::arg("data"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_file", py::overload_cast<const std::string&>(&SecurityAnalyzer::analyzeFile, py::const_),
+             "Analyze a file in place (memory-mapped); PDFs are detected from their magic bytes",
+             py::arg("path"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_file",
+             py::overload_cast<const std::string&, const AnalysisOptions&>(&SecurityAnalyzer::analyzeFile, py::const_),
+             "Analyze a file in place within the given limits",
+             py::arg("path"), py::arg("limits"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_file",
+             py::overload_cast<const std::string&, const std::string&>(&SecurityAnalyzer::analyzeFile, py::const_),
+             "Analyze a file in place under a profile from set_profile",
+             py::arg("path"), py::arg("profile_id"), py::call_guard<py::gil_scoped_release>())
+        .def("analyze_file",
+             py::overload_cast<const std::string&, const std::string&, const AnalysisOptions&>(
+                 &SecurityAnalyzer::analyzeFile, py::const_),
+             "Analyze a file in place under a profile from set_profile, within the given limits",
+             py::arg("path"), py::arg("profile_id"), py::arg("limits"), py::call_guard<py::gil_scoped_release>())
         .def("is_content_safe", &SecurityAnalyzer::isContentSafe, 
              "Check if content is safe based on threshold",
-             py::arg("content"), py::arg("threshold") = 0.8);
+             py::arg("content"), py::arg("threshold") = 0.8,
+             py::call_guard<py::gil_scoped_release>())
+        // Awaitable forms: the analysis runs on the native pool and its
+        // asyncio future is resolved on the calling loop, so concurrent
+        // uploads need no Python threads
+        .def("analyze_text_async", [](const SecurityAnalyzer& self, const py::object& text,
+                                      std::optional<AnalysisOptions> limits) {
+            return analyzeOnLoop(self, text, false, std::move(limits));
+        }, "Analyze text (str or bytes-like) on the native pool; returns an asyncio future of the result",
+           py::arg("text"), py::arg("limits") = py::none(), py::keep_alive<0, 1>())
+        .def("analyze_pdf_async", [](const SecurityAnalyzer& self, const py::object& data,
+                                     std::optional<AnalysisOptions> limits) {
+            return analyzeOnLoop(self, data, true, std::move(limits));
+        }, "Analyze PDF data on the native pool; returns an asyncio future of the result",
+           py::arg("data"), py::arg("limits") = py::none(), py::keep_alive<0, 1>())
+        .def("analyze_batch", &SecurityAnalyzer::analyzeBatch,
+             "Analyze a list of texts in parallel; results are returned in input order",
+             py::arg("texts"), py::call_guard<py::gil_scoped_release>())
+        .def("cache_stats", &SecurityAnalyzer::cacheStats, "Result cache hit/miss counters and size")
+        .def("clear_cache", &SecurityAnalyzer::clearCache, "Drop all cached results")
+        .def("get_metrics", &SecurityAnalyzer::getMetrics,
+             "Per-stage latency histograms and counters since the analyzer was created",
+             py::call_guard<py::gil_scoped_release>())
+        .def("analyze_pdf_batch", [](const SecurityAnalyzer& self, const std::vector<py::buffer>& documents) {
+            std::vector<std::unique_ptr<BufferView>> held;
+            std::vector<ByteView> views;
+            held.reserve(documents.size());
+            views.reserve(documents.size());
+            for (const auto& document : documents) {
+                held.push_back(std::make_unique<BufferView>(document));
+                views.push_back(held.back()->bytes());
+            }
+            py::gil_scoped_release release;
+            return self.analyzePDFBatch(views);
+        }, "Analyze a list of PDF documents in parallel; results are returned in input order",
+           py::arg("documents"));
+
+    py::class_<StreamingAnalyzer>(m, "StreamingAnalyzer")
+        .def(py::init<const SecurityAnalyzer&>(), py::arg("analyzer"), py::keep_alive<1, 2>(),
+             "Start a chunked analysis session; the analyzer is kept alive for the session")
+        .def("feed", &StreamingAnalyzer::feed, "Scan the next chunk of text",
+             py::arg("chunk"), py::call_guard<py::gil_scoped_release>())
+        .def("feed", [](StreamingAnalyzer& self, const py::buffer& chunk) {
+            BufferView view(chunk);
+            py::gil_scoped_release release;
+            self.feed(view.text());
+        }, "Scan the next chunk held in a bytes-like object without copying it",
+           py::arg("chunk"))
+        .def("finish", &StreamingAnalyzer::finish, "End the stream and return the analysis result",
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("settled", &StreamingAnalyzer::settled,
+                               "True once further chunks can no longer change the verdict")
+        .def_property_readonly("bytes_fed", &StreamingAnalyzer::bytesFed);
+
+    py::class_<RulesetDirectory>(m, "RulesetDirectory")
+        .def(py::init<std::string>(), py::arg("path"),
+             "Directory of ruleset generations shared by the processes on a node (e.g. under /dev/shm)")
+        .def("publish", &RulesetDirectory::publish, "Make ruleset the next generation; returns its number",
+             py::arg("ruleset"), py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("current_generation", &RulesetDirectory::currentGeneration,
+                               "Generation now current, 0 if none was published")
+        .def("open_current", [](const RulesetDirectory& self) {
+            return std::const_pointer_cast<Ruleset>(self.openCurrent());
+        }, "Map the current generation", py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("path", &RulesetDirectory::path);
+
+    py::class_<RulesetFollower>(m, "RulesetFollower")
+        .def(py::init<SecurityAnalyzer&, RulesetDirectory>(), py::arg("analyzer"), py::arg("directory"),
+             py::keep_alive<1, 2>(), "Keep analyzer on the current generation of directory")
+        .def("poll", &RulesetFollower::poll, "Swap in a newer generation if there is one; True if it did",
+             py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("generation", &RulesetFollower::generation);
 
     m.def("get_version", []() {
         return std::string("1.0.0");
@@ -0,0 +1,435 @@
+#include "AnalyzerServer.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Bytes read from a connection before its buffered requests are dispatched
+const size_t READ_CHUNK = 64 * 1024;
+
+[[noreturn]] void throwErrno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        throwErrno("invalid socket path " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+void closeFd(int& fd) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+} // namespace
+
+struct AnalyzerServer::Connection {
+    explicit Connection(int socket) : fd(socket), cancel(std::make_shared<CancellationToken>()) {}
+
+    const int fd;
+    // Set on close, so analyses still running for it stop early
+    const std::shared_ptr<CancellationToken> cancel;
+    std::string in;           // epoll thread only
+    uint32_t events = 0;      // registered with epoll; epoll thread only
+
+    std::mutex mutex;
+    std::string out;          // encoded responses not yet written
+    size_t pending = 0;       // requests queued or running
+    bool closed = false;
+};
+
+AnalyzerServer::AnalyzerServer(const SecurityAnalyzer& analyzer, ServerOptions options)
+    : analyzer_(analyzer), options_(std::move(options)) {
+    const sockaddr_un address = socketAddress(options_.socket_path);
+    auto fail = [this](const std::string& what) {
+        const int error = errno;
+        closeFd(listen_fd_);
+        closeFd(epoll_fd_);
+        closeFd(wake_fd_);
+        errno = error;
+        throwErrno(what);
+    };
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        fail("cannot create socket");
+    }
+    ::unlink(options_.socket_path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        fail("cannot bind " + options_.socket_path);
+    }
+    if (::listen(listen_fd_, SOMAXCONN) != 0) {
+        fail("cannot listen on " + options_.socket_path);
+    }
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        fail("cannot create event loop");
+    }
+    for (int fd : {listen_fd_, wake_fd_}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            fail("cannot watch listening socket");
+        }
+    }
+    pool_ = std::make_unique<ThreadPool>(options_.workers, options_.pin_workers);
+}
+
+AnalyzerServer::~AnalyzerServer() {
+    pool_.reset();
+    for (auto& entry : connections_) {
+        ::close(entry.first);
+    }
+    closeFd(listen_fd_);
+    closeFd(epoll_fd_);
+    closeFd(wake_fd_);
+    ::unlink(options_.socket_path.c_str());
+}
+
+void AnalyzerServer::run() {
+    epoll_event events[64];
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        const int ready = ::epoll_wait(epoll_fd_, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throwErrno("epoll_wait failed");
+        }
+        for (int i = 0; i < ready; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                accept();
+                continue;
+            }
+            if (fd == wake_fd_) {
+                uint64_t count;
+                while (::read(wake_fd_, &count, sizeof(count)) > 0) {
+                }
+                drainCompleted();
+                continue;
+            }
+            auto found = connections_.find(fd);
+            if (found == connections_.end()) {
+                continue;
+            }
+            const std::shared_ptr<Connection> connection = found->second;
+            if (events[i].events & EPOLLIN) {
+                readFrom(connection);
+            }
+            if (connections_.count(fd) && (events[i].events & EPOLLOUT)) {
+                flush(connection);
+            }
+            if (connections_.count(fd) && (events[i].events & (EPOLLERR | EPOLLHUP)) &&
+                !(events[i].events & EPOLLIN)) {
+                close(connection);
+            }
+        }
+    }
+
+    // Cancel what is still running for the clients, then wait for it
+    while (!connections_.empty()) {
+        close(connections_.begin()->second);
+    }
+    pool_.reset();
+}
+
+void AnalyzerServer::stop() {
+    stopping_.store(true, std::memory_order_relaxed);
+    const uint64_t one = 1;
+    // Only async-signal-safe calls here
+    [[maybe_unused]] ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void AnalyzerServer::accept() {
+    for (;;) {
+        const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN once the backlog is empty; anything else (EMFILE, a
+            // client gone before accept) is retried on the next event
+            return;
+        }
+        auto connection = std::make_shared<Connection>(fd);
+        connection->events = EPOLLIN;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections_[fd] = std::move(connection);
+    }
+}
+
+void AnalyzerServer::readFrom(const std::shared_ptr<Connection>& connection) {
+    char chunk[16 * 1024];
+    // Bounded per event, so one busy client cannot starve the others
+    for (size_t total = 0; total < READ_CHUNK;) {
+        const ssize_t got = ::read(connection->fd, chunk, sizeof(chunk));
+        if (got > 0) {
+            connection->in.append(chunk, static_cast<size_t>(got));
+            total += static_cast<size_t>(got);
+            continue;
+        }
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        close(connection);
+        return;
+    }
+    dispatch(connection);
+}
+
+void AnalyzerServer::dispatch(const std::shared_ptr<Connection>& connection) {
+    size_t consumed = 0;
+    try {
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                if (connection->pending >= options_.max_pending_per_connection) {
+                    break;
+                }
+            }
+            IpcRequest request;
+            const size_t size = parseRequest(std::string_view(connection->in).substr(consumed), request);
+            if (size == 0) {
+                break;
+            }
+            consumed += size;
+            {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                ++connection->pending;
+            }
+            std::string payload(request.payload);
+            pool_->submit([this, connection, request, payload = std::move(payload)]() mutable {
+                request.payload = payload;
+                std::string frame = handle(request, connection->cancel);
+                {
+                    std::lock_guard<std::mutex> lock(connection->mutex);
+                    --connection->pending;
+                    if (connection->closed) {
+                        return;
+                    }
+                    connection->out += frame;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(completed_mutex_);
+                    completed_.push_back(connection);
+                }
+                const uint64_t one = 1;
+                [[maybe_unused]] ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+            });
+        }
+    } catch (const std::runtime_error&) {
+        // A malformed or oversized frame leaves the stream unparseable
+        close(connection);
+        return;
+    }
+    connection->in.erase(0, consumed);
+    updateEvents(connection);
+}
+
+std::string AnalyzerServer::handle(const IpcRequest& request,
+                                   std::shared_ptr<const CancellationToken> cancel) const {
+    IpcResponse response;
+    try {
+        AnalysisOptions limits = request.timeout_ms > 0
+            ? AnalysisOptions::withTimeout(std::chrono::milliseconds(request.timeout_ms))
+            : AnalysisOptions();
+        limits.cancel = std::move(cancel);
+        const bool spans = request.flags & IPC_FLAG_SPANS;
+        switch (request.op) {
+        case IPC_PING:
+            break;
+        case IPC_ANALYZE_TEXT:
+            response = toIpcResponse(request.id, spans ? analyzer_.analyzeTextSpans(request.payload, limits)
+                                                       : analyzer_.analyzeText(request.payload, limits));
+            break;
+        case IPC_ANALYZE_PDF: {
+            PDFScanOptions full;
+            full.stop_when_decided = false;
+            full.collect_spans = spans;
+            const ByteView bytes(reinterpret_cast<const uint8_t*>(request.payload.data()), request.payload.size());
+            response = toIpcResponse(request.id, analyzer_.analyzePDF(bytes, full, limits));
+            break;
+        }
+        default:
+            response.status = IPC_BAD_REQUEST;
+            response.error = "unknown op " + std::to_string(request.op);
+            break;
+        }
+    } catch (const std::exception& e) {
+        response = IpcResponse();
+        response.status = IPC_SERVER_ERROR;
+        response.error = e.what();
+    }
+    response.id = request.id;
+    std::string frame;
+    appendResponse(response, frame);
+    return frame;
+}
+
+void AnalyzerServer::flush(const std::shared_ptr<Connection>& connection) {
+    bool failed = false;
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        size_t sent = 0;
+        while (sent < connection->out.size()) {
+            const ssize_t wrote = ::send(connection->fd, connection->out.data() + sent,
+                                         connection->out.size() - sent, MSG_NOSIGNAL);
+            if (wrote > 0) {
+                sent += static_cast<size_t>(wrote);
+            } else if (wrote < 0 && errno == EINTR) {
+                continue;
+            } else {
+                failed = !(wrote < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+                break;
+            }
+        }
+        connection->out.erase(0, sent);
+    }
+    if (failed) {
+        close(connection);
+        return;
+    }
+    updateEvents(connection);
+}
+
+void AnalyzerServer::drainCompleted() {
+    std::vector<std::shared_ptr<Connection>> completed;
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex_);
+        completed.swap(completed_);
+    }
+    for (const auto& connection : completed) {
+        auto found = connections_.find(connection->fd);
+        if (found == connections_.end() || found->second != connection) {
+            continue;
+        }
+        flush(connection);
+        // The connection may have been paused at its pending limit with
+        // whole requests still buffered
+        if (connections_.count(connection->fd) && !connection->in.empty()) {
+            dispatch(connection);
+        }
+    }
+}
+
+void AnalyzerServer::close(const std::shared_ptr<Connection>& connection) {
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->closed = true;
+        connection->out.clear();
+    }
+    connection->cancel->cancel();
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+    ::close(connection->fd);
+    connections_.erase(connection->fd);
+}
+
+void AnalyzerServer::updateEvents(const std::shared_ptr<Connection>& connection) {
+    uint32_t wanted = 0;
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        if (connection->pending < options_.max_pending_per_connection) {
+            wanted |= EPOLLIN;
+        }
+        if (!connection->out.empty()) {
+            wanted |= EPOLLOUT;
+        }
+    }
+    if (wanted == connection->events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = wanted;
+    event.data.fd = connection->fd;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event) == 0) {
+        connection->events = wanted;
+    }
+}
+
+AnalyzerClient::AnalyzerClient(const std::string& socket_path) {
+    const sockaddr_un address = socketAddress(socket_path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throwErrno("cannot create socket");
+    }
+    if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        closeFd(fd_);
+        errno = error;
+        throwErrno("cannot connect to " + socket_path);
+    }
+}
+
+AnalyzerClient::~AnalyzerClient() {
+    closeFd(fd_);
+}
+
+IpcResponse AnalyzerClient::call(IpcOp op, std::string_view payload, uint32_t timeout_ms, uint8_t flags) {
+    IpcRequest request;
+    request.id = next_id_++;
+    request.op = op;
+    request.flags = flags;
+    request.timeout_ms = timeout_ms;
+    request.payload = payload;
+    std::string frame;
+    appendRequest(request, frame);
+    for (size_t sent = 0; sent < frame.size();) {
+        const ssize_t wrote = ::send(fd_, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (wrote < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throwErrno("cannot send request");
+        }
+        sent += static_cast<size_t>(wrote);
+    }
+
+    IpcResponse response;
+    for (;;) {
+        const size_t size = parseResponse(buffer_, response);
+        if (size > 0) {
+            buffer_.erase(0, size);
+            if (response.id != request.id) {
+                throw std::runtime_error("response for request " + std::to_string(response.id) +
+                                         " while waiting for " + std::to_string(request.id));
+            }
+            return response;
+        }
+        char chunk[16 * 1024];
+        const ssize_t got = ::read(fd_, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            throwErrno("cannot read response");
+        }
+        if (got == 0) {
+            throw std::runtime_error("server closed the connection");
+        }
+        buffer_.append(chunk, static_cast<size_t>(got));
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "IpcProtocol.h"
+#include "SecurityAnalyzer.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ServerOptions {
+    std::string socket_path;
+    size_t workers = 0;              // 0 = one per hardware thread
+    bool pin_workers = true;         // bind worker i to CPU i
+    // Requests a connection may have queued or running before the server
+    // stops reading from it
+    size_t max_pending_per_connection = 64;
+};
+
+// Serves one shared SecurityAnalyzer to local clients over a Unix stream
+// socket, speaking the protocol in IpcProtocol.h.
+//
+// A single thread runs an epoll loop that accepts connections, reads
+// requests without blocking and writes responses; the analyses run on a
+// worker pool. Workers hand finished responses back through an eventfd, so
+// a slow client never holds a worker. A connection that closes cancels its
+// requests still in flight.
+class AnalyzerServer {
+public:
+    // Binds and listens, replacing a stale socket file; throws
+    // std::system_error on failure
+    AnalyzerServer(const SecurityAnalyzer& analyzer, ServerOptions options);
+    ~AnalyzerServer();
+
+    AnalyzerServer(const AnalyzerServer&) = delete;
+    AnalyzerServer& operator=(const AnalyzerServer&) = delete;
+
+    // Serves until stop(), then waits for the requests already running
+    void run();
+    // Safe to call from any thread and from a signal handler
+    void stop();
+
+    const std::string& socketPath() const { return options_.socket_path; }
+
+private:
+    struct Connection;
+
+    void accept();
+    void readFrom(const std::shared_ptr<Connection>& connection);
+    void dispatch(const std::shared_ptr<Connection>& connection);
+    void flush(const std::shared_ptr<Connection>& connection);
+    void drainCompleted();
+    void close(const std::shared_ptr<Connection>& connection);
+    void updateEvents(const std::shared_ptr<Connection>& connection);
+    std::string handle(const IpcRequest& request, std::shared_ptr<const CancellationToken> cancel) const;
+
+    const SecurityAnalyzer& analyzer_;
+    ServerOptions options_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;  // eventfd: responses ready, or stop requested
+    std::atomic<bool> stopping_{false};
+    std::unique_ptr<ThreadPool> pool_;
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;  // epoll thread only
+
+    std::mutex completed_mutex_;
+    std::vector<std::shared_ptr<Connection>> completed_;  // connections with new responses
+};
+
+// Blocking client for AnalyzerServer, one request at a time
+class AnalyzerClient {
+public:
+    // Connects to the server socket; throws std::system_error on failure
+    explicit AnalyzerClient(const std::string& socket_path);
+    ~AnalyzerClient();
+
+    AnalyzerClient(const AnalyzerClient&) = delete;
+    AnalyzerClient& operator=(const AnalyzerClient&) = delete;
+
+    IpcResponse call(IpcOp op, std::string_view payload, uint32_t timeout_ms = 0, uint8_t flags = 0);
+
+private:
+    int fd_ = -1;
+    uint32_t next_id_ = 1;
+    std::string buffer_;
+};
@@ -0,0 +1,142 @@
+#include "ByteScan.h"
+
+#if !defined(SECURITY_ANALYZER_NO_SIMD)
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTESCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define BYTESCAN_NEON 1
+#endif
+#endif
+
+void ByteSet::add(unsigned char c) {
+    if (c >= 0x80) {
+        return;
+    }
+    hi_table_[c >> 4] = static_cast<uint8_t>(1u << (c >> 4));
+    lo_table_[c & 0x0f] |= static_cast<uint8_t>(1u << (c >> 4));
+}
+
+bool ByteSet::empty() const {
+    for (uint8_t bits : lo_table_) {
+        if (bits != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+using FindFn = size_t (*)(const unsigned char*, size_t, const ByteSet&);
+
+size_t findScalar(const unsigned char* data, size_t size, const ByteSet& set) {
+    for (size_t i = 0; i < size; ++i) {
+        if (set.contains(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+#if defined(BYTESCAN_X86)
+__attribute__((target("avx2")))
+size_t findAvx2(const unsigned char* data, size_t size, const ByteSet& set) {
+    const __m256i lo_table = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.loTable())));
+    const __m256i hi_table = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.hiTable())));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(v, nibble));
+        const __m256i hi = _mm256_shuffle_epi8(hi_table,
+            _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+        const uint32_t hits = ~static_cast<uint32_t>(_mm256_movemask_epi8(miss));
+        if (hits != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(hits));
+        }
+    }
+    return i + findScalar(data + i, size - i, set);
+}
+
+__attribute__((target("ssse3")))
+size_t findSsse3(const unsigned char* data, size_t size, const ByteSet& set) {
+    const __m128i lo_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.loTable()));
+    const __m128i hi_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.hiTable()));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(v, nibble));
+        const __m128i hi = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        const __m128i miss = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero);
+        const uint32_t hits = ~static_cast<uint32_t>(_mm_movemask_epi8(miss)) & 0xffffu;
+        if (hits != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(hits));
+        }
+    }
+    return i + findScalar(data + i, size - i, set);
+}
+#endif
+
+#if defined(BYTESCAN_NEON)
+size_t findNeon(const unsigned char* data, size_t size, const ByteSet& set) {
+    const uint8x16_t lo_table = vld1q_u8(set.loTable());
+    const uint8x16_t hi_table = vld1q_u8(set.hiTable());
+    const uint8x16_t nibble = vdupq_n_u8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t v = vld1q_u8(data + i);
+        const uint8x16_t lo = vqtbl1q_u8(lo_table, vandq_u8(v, nibble));
+        const uint8x16_t hi = vqtbl1q_u8(hi_table, vshrq_n_u8(v, 4));
+        if (vmaxvq_u8(vandq_u8(lo, hi)) != 0) {
+            return i + findScalar(data + i, 16, set);
+        }
+    }
+    return i + findScalar(data + i, size - i, set);
+}
+#endif
+
+struct Kernel {
+    FindFn find;
+    const char* name;
+};
+
+Kernel selectKernel() {
+#if defined(BYTESCAN_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {findAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return {findSsse3, "ssse3"};
+    }
+#elif defined(BYTESCAN_NEON)
+    return {findNeon, "neon"};
+#endif
+    return {findScalar, "scalar"};
+}
+
+const Kernel& kernel() {
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+} // namespace
+
+size_t findFirstOf(std::string_view text, const ByteSet& set) {
+    return kernel().find(reinterpret_cast<const unsigned char*>(text.data()), text.size(), set);
+}
+
+const char* byteScanKernel() {
+    return kernel().name;
+}
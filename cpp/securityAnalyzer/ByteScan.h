@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Set of ASCII bytes, laid out for the SIMD classifiers: a byte b is a member
+// iff lo_table[b & 0xf] & hi_table[b >> 4] is non-zero (one bit per high
+// nibble, so any subset of 0x00-0x7f is representable exactly).
+class ByteSet {
+public:
+    // Only ASCII bytes can be added; non-ASCII bytes are never members.
+    void add(unsigned char c);
+    bool contains(unsigned char c) const {
+        return (lo_table_[c & 0x0f] & hi_table_[c >> 4]) != 0;
+    }
+    bool empty() const;
+
+    const uint8_t* loTable() const { return lo_table_.data(); }
+    const uint8_t* hiTable() const { return hi_table_.data(); }
+
+private:
+    std::array<uint8_t, 16> lo_table_{};
+    std::array<uint8_t, 16> hi_table_{};
+};
+
+// Offset of the first byte of text that is in set, or text.size() if none.
+// Uses the widest kernel the CPU supports (AVX2, SSSE3 or NEON), picked once
+// at startup; builds with SECURITY_ANALYZER_NO_SIMD use the scalar loop only.
+size_t findFirstOf(std::string_view text, const ByteSet& set);
+
+// Name of the kernel findFirstOf dispatches to ("avx2", "ssse3", "neon" or "scalar")
+const char* byteScanKernel();
@@ -0,0 +1,284 @@
+#include "EncodedRuns.h"
+#include "ByteScan.h"
+#include "TextNormalizer.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+// Escapes closer together than this belong to one run
+const size_t ESCAPE_GAP = 16;
+// How far a run is widened over unencoded bytes on either side
+const size_t ESCAPE_CONTEXT = 64;
+const size_t MIN_BASE64_RUN = 12;
+
+struct NamedReference {
+    const char* name;
+    char value;
+};
+
+// The references that spell out syntax the detectors look for
+const NamedReference named_references[] = {
+    {"lt", '<'},      {"gt", '>'},      {"amp", '&'},     {"quot", '"'},    {"apos", '\''},
+    {"sol", '/'},     {"bsol", '\\'},   {"lpar", '('},    {"rpar", ')'},    {"colon", ':'},
+    {"semi", ';'},    {"equals", '='},  {"period", '.'},  {"comma", ','},   {"excl", '!'},
+    {"num", '#'},     {"dollar", '$'},  {"percnt", '%'},  {"plus", '+'},    {"lowbar", '_'},
+    {"grave", '`'},   {"verbar", '|'},  {"vert", '|'},    {"ast", '*'},     {"midast", '*'},
+    {"quest", '?'},   {"commat", '@'},  {"lsqb", '['},    {"rsqb", ']'},    {"lbrack", '['},
+    {"rbrack", ']'},  {"lcub", '{'},    {"rcub", '}'},    {"lbrace", '{'},  {"rbrace", '}'},
+    {"hyphen", '-'},  {"dash", '-'},    {"nbsp", ' '},    {"Tab", '\t'},    {"NewLine", '\n'},
+};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+void appendCodePoint(uint32_t cp, std::string& out) {
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        cp = 0xFFFD;
+    }
+    // Through the normalizer, so &#xff1c; folds like a literal U+FF1C would
+    if (cp < 0x10000) {
+        const uint16_t unit = static_cast<uint16_t>(cp);
+        appendNormalizedUtf8(&unit, 1, out);
+    } else {
+        const uint16_t units[] = {static_cast<uint16_t>(0xD800 + ((cp - 0x10000) >> 10)),
+                                  static_cast<uint16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF))};
+        appendNormalizedUtf8(units, 2, out);
+    }
+}
+
+// Length of the escape or character reference at text[pos], 0 if there is
+// none. Its decoded bytes are appended to out when given.
+size_t decodeEscape(std::string_view text, size_t pos, std::string* out) {
+    if (text[pos] == '%') {
+        if (pos + 2 >= text.size()) {
+            return 0;
+        }
+        const int hi = hexValue(text[pos + 1]);
+        const int lo = hexValue(text[pos + 2]);
+        if (hi < 0 || lo < 0) {
+            return 0;
+        }
+        if (out) {
+            *out += static_cast<char>(hi * 16 + lo);
+        }
+        return 3;
+    }
+
+    // &...; with at most 10 characters in between
+    const size_t semi = text.substr(pos, 12).find(';');
+    if (semi == std::string_view::npos || semi < 2) {
+        return 0;
+    }
+    const std::string_view body = text.substr(pos + 1, semi - 1);
+    if (body[0] == '#') {
+        const bool hex = body.size() > 1 && (body[1] == 'x' || body[1] == 'X');
+        const size_t first = hex ? 2 : 1;
+        if (body.size() <= first || body.size() - first > (hex ? 6u : 7u)) {
+            return 0;
+        }
+        uint32_t cp = 0;
+        for (size_t i = first; i < body.size(); ++i) {
+            const int digit = hex ? hexValue(body[i]) : (body[i] >= '0' && body[i] <= '9' ? body[i] - '0' : -1);
+            if (digit < 0) {
+                return 0;
+            }
+            cp = cp * (hex ? 16 : 10) + static_cast<uint32_t>(digit);
+        }
+        if (out) {
+            appendCodePoint(cp, *out);
+        }
+        return semi + 1;
+    }
+    for (const NamedReference& reference : named_references) {
+        if (body == reference.name) {
+            if (out) {
+                *out += reference.value;
+            }
+            return semi + 1;
+        }
+    }
+    return 0;
+}
+
+const ByteSet& escapeStarts() {
+    static const ByteSet starts = []() {
+        ByteSet set;
+        set.add('%');
+        set.add('&');
+        return set;
+    }();
+    return starts;
+}
+
+// Offset of the next escape at or after from and before limit, or limit
+size_t findEscape(std::string_view text, size_t from, size_t limit, size_t& length) {
+    while (from < limit) {
+        const size_t pos = from + findFirstOf(text.substr(from, limit - from), escapeStarts());
+        if (pos >= limit) {
+            break;
+        }
+        length = decodeEscape(text, pos, nullptr);
+        if (length != 0) {
+            return pos;
+        }
+        from = pos + 1;
+    }
+    return limit;
+}
+
+constexpr std::array<int8_t, 256> base64Values() {
+    std::array<int8_t, 256> values{};
+    for (auto& value : values) {
+        value = -1;
+    }
+    for (int i = 0; i < 26; ++i) {
+        values['A' + i] = static_cast<int8_t>(i);
+        values['a' + i] = static_cast<int8_t>(26 + i);
+    }
+    for (int i = 0; i < 10; ++i) {
+        values['0' + i] = static_cast<int8_t>(52 + i);
+    }
+    values['+'] = 62;
+    values['/'] = 63;
+    return values;
+}
+constexpr std::array<int8_t, 256> base64_values = base64Values();
+
+bool isBase64(char c) {
+    return base64_values[static_cast<unsigned char>(c)] >= 0;
+}
+
+bool isPrintable(unsigned char c) {
+    return (c >= 0x20 && c < 0x7f) || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // namespace
+
+bool EncodedRunFinder::next(DecodedRun& run) {
+    return nextEscaped(run) || nextBase64(run);
+}
+
+bool EncodedRunFinder::nextEscaped(DecodedRun& run) {
+    const size_t n = text_.size();
+    size_t length = 0;
+    const size_t first = findEscape(text_, escape_pos_, n, length);
+    if (first >= n) {
+        escape_pos_ = n;
+        return false;
+    }
+    size_t last_end = first + length;
+    for (;;) {
+        const size_t next = findEscape(text_, last_end, std::min(n, last_end + ESCAPE_GAP), length);
+        if (next >= std::min(n, last_end + ESCAPE_GAP)) {
+            break;
+        }
+        last_end = next + length;
+    }
+
+    // Widen to the tokens around the cluster, without reaching back into the
+    // previous run or rescanning a whole long token for each escape in it
+    size_t begin = first;
+    const size_t floor = std::max(escape_pos_, first > ESCAPE_CONTEXT ? first - ESCAPE_CONTEXT : 0);
+    while (begin > floor && !isSpace(text_[begin - 1])) {
+        --begin;
+    }
+    size_t end = last_end;
+    const size_t ceiling = std::min(n, last_end + ESCAPE_CONTEXT);
+    while (end < ceiling && !isSpace(text_[end])) {
+        ++end;
+    }
+
+    run.encoding = RUN_ESCAPED;
+    run.begin = begin;
+    run.end = end;
+    run.text.clear();
+    run.origin.clear();
+    for (size_t i = begin; i < end;) {
+        const size_t decoded_from = run.text.size();
+        const size_t escape = (text_[i] == '%' || text_[i] == '&') ? decodeEscape(text_, i, &run.text) : 0;
+        if (escape == 0) {
+            run.text += text_[i];
+        }
+        run.origin.insert(run.origin.end(), run.text.size() - decoded_from, i);
+        i += escape == 0 ? 1 : escape;
+    }
+    run.origin.push_back(end);
+    escape_pos_ = end;
+    return true;
+}
+
+bool EncodedRunFinder::nextBase64(DecodedRun& run) {
+    const size_t n = text_.size();
+    size_t i = base64_pos_;
+    while (i + MIN_BASE64_RUN <= n) {
+        // A run covering i..i+MIN-1 includes its last byte; if that is not
+        // base64, no run can start before it
+        if (!isBase64(text_[i + MIN_BASE64_RUN - 1])) {
+            i += MIN_BASE64_RUN;
+            continue;
+        }
+        size_t begin = i + MIN_BASE64_RUN - 1;
+        while (begin > i && isBase64(text_[begin - 1])) {
+            --begin;
+        }
+        size_t chars_end = i + MIN_BASE64_RUN;
+        while (chars_end < n && isBase64(text_[chars_end])) {
+            ++chars_end;
+        }
+        size_t end = chars_end;
+        while (end < n && end - chars_end < 2 && text_[end] == '=') {
+            ++end;
+        }
+        // '=' is not in the alphabet, so a run may start right after padding
+        i = end == chars_end ? end + 1 : end;
+        if (chars_end - begin < MIN_BASE64_RUN) {
+            continue;
+        }
+
+        // A trailing lone character carries no whole byte
+        const size_t chars = (chars_end - begin) - ((chars_end - begin) % 4 == 1 ? 1 : 0);
+        run.text.clear();
+        run.origin.clear();
+        uint32_t bits = 0;
+        int bit_count = 0;
+        bool printable = true;
+        for (size_t k = 0; k < chars && printable; ++k) {
+            bits = (bits << 6) | static_cast<uint32_t>(base64_values[static_cast<unsigned char>(text_[begin + k])]);
+            bit_count += 6;
+            if (bit_count >= 8) {
+                bit_count -= 8;
+                const unsigned char byte = static_cast<unsigned char>((bits >> bit_count) & 0xFF);
+                printable = isPrintable(byte);
+                run.origin.push_back(begin + run.text.size() * 4 / 3);
+                run.text += static_cast<char>(byte);
+            }
+        }
+        if (!printable) {
+            continue;
+        }
+        run.origin.push_back(end);
+        run.encoding = RUN_BASE64;
+        run.begin = begin;
+        run.end = end;
+        base64_pos_ = i;
+        return true;
+    }
+    base64_pos_ = n;
+    return false;
+}
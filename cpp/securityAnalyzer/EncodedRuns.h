@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How many layers of encoding are unwrapped (URL-encoded base64 is two)
+constexpr int MAX_DECODE_DEPTH = 3;
+
+enum RunEncoding {
+    RUN_ESCAPED,  // URL %XX escapes and HTML character references, mixed freely
+    RUN_BASE64,
+};
+
+// One encoded run of a text and its decoded bytes
+struct DecodedRun {
+    RunEncoding encoding = RUN_ESCAPED;
+    size_t begin = 0;  // the encoded bytes are text[begin, end)
+    size_t end = 0;
+    std::string text;
+    // origin[i] is the offset in the encoded text of what decoded to
+    // text[i]; origin[text.size()] is end, so text[b, e) came from
+    // [origin[b], origin[e])
+    std::vector<size_t> origin;
+};
+
+// Walks the encoded runs of a text, one layer deep, decoding each only when
+// it is reached:
+//
+//  - escaped runs: clusters of %XX escapes and &name; / &#N; / &#xN;
+//    references, each gap under 16 bytes, widened to the surrounding
+//    whitespace-separated tokens so partly encoded words decode whole
+//  - base64 runs: at least 12 characters of the standard alphabet, kept only
+//    when they decode to printable text
+//
+// Text without '%' or '&' is passed over by a vectorized byte scan, and the
+// base64 search skips ahead by a whole minimum run length at a time over
+// text that has no long alphanumeric tokens.
+class EncodedRunFinder {
+public:
+    explicit EncodedRunFinder(std::string_view text) : text_(text) {}
+
+    // Decodes the next run into run, reusing its buffers; false once there
+    // are no more
+    bool next(DecodedRun& run);
+
+private:
+    bool nextEscaped(DecodedRun& run);
+    bool nextBase64(DecodedRun& run);
+
+    std::string_view text_;
+    size_t escape_pos_ = 0;
+    size_t base64_pos_ = 0;
+};
@@ -0,0 +1,198 @@
+#include "IpcProtocol.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+void putU8(std::string& out, uint8_t value) {
+    out += static_cast<char>(value);
+}
+
+void putU16(std::string& out, uint16_t value) {
+    putU8(out, static_cast<uint8_t>(value));
+    putU8(out, static_cast<uint8_t>(value >> 8));
+}
+
+void putU32(std::string& out, uint32_t value) {
+    putU16(out, static_cast<uint16_t>(value));
+    putU16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void putU64(std::string& out, uint64_t value) {
+    putU32(out, static_cast<uint32_t>(value));
+    putU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void putString(std::string& out, std::string_view value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value.data(), value.size());
+}
+
+// Writes the size prefix once the frame started at start is complete
+void closeFrame(std::string& out, size_t start) {
+    const uint32_t size = static_cast<uint32_t>(out.size() - start - 4);
+    for (int i = 0; i < 4; ++i) {
+        out[start + i] = static_cast<char>(size >> (8 * i));
+    }
+}
+
+// Bounds-checked reads from one frame
+class FrameReader {
+public:
+    explicit FrameReader(std::string_view frame) : frame_(frame) {}
+
+    uint64_t get(size_t bytes) {
+        need(bytes);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(frame_[pos_ + i])) << (8 * i);
+        }
+        pos_ += bytes;
+        return value;
+    }
+
+    std::string_view bytes(size_t count) {
+        need(count);
+        std::string_view out = frame_.substr(pos_, count);
+        pos_ += count;
+        return out;
+    }
+
+    std::string_view rest() { return bytes(frame_.size() - pos_); }
+
+private:
+    void need(size_t bytes) const {
+        if (frame_.size() - pos_ < bytes) {
+            throw std::runtime_error("truncated IPC frame");
+        }
+    }
+
+    std::string_view frame_;
+    size_t pos_ = 0;
+};
+
+// Size of the frame at the start of buffer, prefix included, or 0 while it
+// is incomplete
+size_t frameSize(std::string_view buffer) {
+    if (buffer.size() < 4) {
+        return 0;
+    }
+    const uint64_t size = FrameReader(buffer.substr(0, 4)).get(4);
+    if (size > IPC_MAX_FRAME) {
+        throw std::runtime_error("IPC frame of " + std::to_string(size) + " bytes exceeds the limit");
+    }
+    return buffer.size() - 4 < size ? 0 : static_cast<size_t>(size) + 4;
+}
+
+} // namespace
+
+void appendRequest(const IpcRequest& request, std::string& out) {
+    const size_t start = out.size();
+    putU32(out, 0);
+    putU32(out, request.id);
+    putU8(out, request.op);
+    putU8(out, request.flags);
+    putU16(out, 0);
+    putU32(out, request.timeout_ms);
+    out.append(request.payload.data(), request.payload.size());
+    closeFrame(out, start);
+}
+
+void appendResponse(const IpcResponse& response, std::string& out) {
+    const size_t start = out.size();
+    putU32(out, 0);
+    putU32(out, response.id);
+    putU8(out, response.status);
+    putU8(out, response.is_safe ? 1 : 0);
+    putU16(out, 0);
+    uint64_t score_bits;
+    std::memcpy(&score_bits, &response.confidence_score, sizeof(score_bits));
+    putU64(out, score_bits);
+    putU32(out, response.pages_analyzed);
+    putU32(out, static_cast<uint32_t>(response.issues.size()));
+    for (const std::string& issue : response.issues) {
+        putString(out, issue);
+    }
+    putU32(out, static_cast<uint32_t>(response.spans.size()));
+    for (const Span& span : response.spans) {
+        putU8(out, span.kind);
+        putU32(out, span.pattern_id);
+        putU64(out, span.begin);
+        putU64(out, span.end);
+        putU32(out, static_cast<uint32_t>(span.page));
+    }
+    putString(out, response.summary);
+    putString(out, response.error);
+    closeFrame(out, start);
+}
+
+size_t parseRequest(std::string_view buffer, IpcRequest& request) {
+    const size_t size = frameSize(buffer);
+    if (size == 0) {
+        return 0;
+    }
+    FrameReader reader(buffer.substr(4, size - 4));
+    request.id = static_cast<uint32_t>(reader.get(4));
+    request.op = static_cast<IpcOp>(reader.get(1));
+    request.flags = static_cast<uint8_t>(reader.get(1));
+    reader.get(2);
+    request.timeout_ms = static_cast<uint32_t>(reader.get(4));
+    request.payload = reader.rest();
+    return size;
+}
+
+size_t parseResponse(std::string_view buffer, IpcResponse& response) {
+    const size_t size = frameSize(buffer);
+    if (size == 0) {
+        return 0;
+    }
+    FrameReader reader(buffer.substr(4, size - 4));
+    response.id = static_cast<uint32_t>(reader.get(4));
+    response.status = static_cast<IpcStatus>(reader.get(1));
+    response.is_safe = reader.get(1) != 0;
+    reader.get(2);
+    const uint64_t score_bits = reader.get(8);
+    std::memcpy(&response.confidence_score, &score_bits, sizeof(score_bits));
+    response.pages_analyzed = static_cast<uint32_t>(reader.get(4));
+    // Counts are checked against the bytes left, so a bad one cannot make
+    // this reserve gigabytes
+    const uint64_t issue_count = reader.get(4);
+    if (issue_count > size / 4) {
+        throw std::runtime_error("IPC response issue count exceeds its frame");
+    }
+    response.issues.clear();
+    for (uint64_t i = 0; i < issue_count; ++i) {
+        response.issues.emplace_back(reader.bytes(reader.get(4)));
+    }
+    const uint64_t span_count = reader.get(4);
+    if (span_count > size / 25) {
+        throw std::runtime_error("IPC response span count exceeds its frame");
+    }
+    response.spans.clear();
+    response.spans.reserve(span_count);
+    for (uint64_t i = 0; i < span_count; ++i) {
+        Span span{static_cast<IssueKind>(reader.get(1))};
+        span.pattern_id = static_cast<uint32_t>(reader.get(4));
+        span.begin = reader.get(8);
+        span.end = reader.get(8);
+        span.page = static_cast<int>(reader.get(4));
+        response.spans.push_back(span);
+    }
+    response.summary = std::string(reader.bytes(reader.get(4)));
+    response.error = std::string(reader.bytes(reader.get(4)));
+    return size;
+}
+
+IpcResponse toIpcResponse(uint32_t id, const AnalysisResult& result) {
+    IpcResponse response;
+    response.id = id;
+    response.is_safe = result.is_safe;
+    response.confidence_score = result.confidence_score;
+    response.pages_analyzed = static_cast<uint32_t>(std::max(result.pages_analyzed, 0));
+    response.issues = result.detectedIssues();
+    response.spans = result.spans;
+    response.summary = result.analysis_summary;
+    response.error = result.error;
+    return response;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "SecurityAnalyzer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Length-prefixed binary protocol spoken by security_analyzer_server over a
+// Unix stream socket. Every frame starts with a little-endian u32 giving the
+// size of the rest of the frame; all other integers are little-endian too.
+//
+//   request:  u32 size | u32 id | u8 op | u8 flags | u16 reserved
+//             | u32 timeout_ms (0 = none) | payload (text or PDF bytes)
+//   response: u32 size | u32 id | u8 status | u8 is_safe | u16 reserved
+//             | f64 confidence_score | u32 pages_analyzed
+//             | u32 issue count, then per issue u32 length + text
+//             | u32 span count, then per span
+//               u8 kind | u32 pattern_id | u64 begin | u64 end | u32 page
+//             | u32 length + summary | u32 length + error
+//
+// A client may send any number of requests without waiting; responses carry
+// the request id and may arrive in any order.
+
+// Frames larger than this close the connection
+constexpr size_t IPC_MAX_FRAME = 16 * 1024 * 1024;
+constexpr size_t IPC_REQUEST_HEADER = 16;
+
+enum IpcOp : uint8_t {
+    IPC_PING = 0,          // empty response with IPC_OK
+    IPC_ANALYZE_TEXT = 1,
+    IPC_ANALYZE_PDF = 2,
+};
+
+enum IpcFlag : uint8_t {
+    IPC_FLAG_SPANS = 1,    // report AnalysisResult::spans
+};
+
+enum IpcStatus : uint8_t {
+    IPC_OK = 0,
+    IPC_BAD_REQUEST = 1,   // unknown op; the error field says why
+    IPC_SERVER_ERROR = 2,
+};
+
+struct IpcRequest {
+    uint32_t id = 0;
+    IpcOp op = IPC_PING;
+    uint8_t flags = 0;
+    uint32_t timeout_ms = 0;
+    std::string_view payload;
+};
+
+struct IpcResponse {
+    uint32_t id = 0;
+    IpcStatus status = IPC_OK;
+    bool is_safe = false;
+    double confidence_score = 0.0;
+    uint32_t pages_analyzed = 0;
+    std::vector<std::string> issues;
+    std::vector<Span> spans;
+    std::string summary;
+    std::string error;
+};
+
+// Encoders append one whole frame to out
+void appendRequest(const IpcRequest& request, std::string& out);
+void appendResponse(const IpcResponse& response, std::string& out);
+
+// Decoders read the frame at the start of buffer and return its size, or 0
+// if buffer does not hold all of it yet. A request payload is a view into
+// buffer. Malformed or oversized frames throw std::runtime_error.
+size_t parseRequest(std::string_view buffer, IpcRequest& request);
+size_t parseResponse(std::string_view buffer, IpcResponse& response);
+
+IpcResponse toIpcResponse(uint32_t id, const AnalysisResult& result);
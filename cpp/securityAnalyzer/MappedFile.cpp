@@ -0,0 +1,60 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void throwErrno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string& path, Access access) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throwErrno("cannot open " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        throwErrno("cannot stat " + path);
+    }
+    if (!S_ISREG(info.st_mode)) {
+        ::close(fd);
+        errno = EINVAL;
+        throwErrno(path + " is not a regular file");
+    }
+
+    // mmap rejects zero-length mappings; an empty file is just an empty view
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            errno = error;
+            throwErrno("cannot map " + path);
+        }
+        // Detectors read front to back, so the kernel may read ahead
+        // aggressively; tables are probed anywhere on every scan, so fault
+        // them all in now
+        ::madvise(mapping, size_, access == SEQUENTIAL ? MADV_SEQUENTIAL : MADV_WILLNEED);
+        data_ = static_cast<const uint8_t*>(mapping);
+    }
+    // The mapping keeps the file referenced after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
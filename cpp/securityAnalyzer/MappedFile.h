@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. Pages are faulted in on first
+// touch, so scanning the mapping never copies the file to the heap.
+// Throws std::system_error if the file cannot be opened or mapped.
+class MappedFile {
+public:
+    // SEQUENTIAL suits documents read front to back; TABLES suits lookup
+    // tables, read at random and kept resident
+    enum Access { SEQUENTIAL, TABLES };
+
+    explicit MappedFile(const std::string& path, Access access = SEQUENTIAL);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view text() const { return {reinterpret_cast<const char*>(data_), size_}; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,175 @@
+#include "Metrics.h"
+#include <algorithm>
+
+namespace {
+
+std::atomic<uint64_t> next_metrics_id{1};
+
+size_t latencyBucket(uint64_t ns) {
+    if (ns == 0) {
+        return 0;
+    }
+    const size_t bucket = 64 - static_cast<size_t>(__builtin_clzll(ns));
+    return std::min(bucket, LATENCY_BUCKETS - 1);
+}
+
+// Only the owning thread writes a shard, so a plain load and store is enough
+// and avoids a locked read-modify-write
+void bump(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+} // namespace
+
+struct Metrics::Shard {
+    struct Stage {
+        std::atomic<uint64_t> total_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> buckets{};
+    };
+    std::array<Stage, STAGE_COUNT> stages;
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    std::array<std::atomic<uint64_t>, MAX_METRIC_CATEGORIES> categories{};
+};
+
+const char* stageName(MetricStage stage) {
+    switch (stage) {
+    case STAGE_ANALYZE_TEXT:
+        return "analyze_text";
+    case STAGE_ANALYZE_PDF:
+        return "analyze_pdf";
+    case STAGE_PDF_STRUCTURE:
+        return "pdf_structure";
+    case STAGE_LOAD_PDF:
+        return "load_pdf";
+    case STAGE_EXTRACT_TEXT:
+        return "extract_text";
+    case STAGE_DETECT_PII:
+        return "detect_pii";
+    case STAGE_DETECT_MALICIOUS:
+        return "detect_malicious_content";
+    case STAGE_COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+uint64_t StageMetrics::percentileNs(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen > 0 && static_cast<double>(seen) >= rank) {
+            return b + 1 < LATENCY_BUCKETS ? std::min(uint64_t{1} << b, max_ns) : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+Metrics::Metrics() : id_(next_metrics_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+Metrics::~Metrics() = default;
+
+Metrics::Shard& Metrics::shard() {
+    struct Local {
+        uint64_t owner;
+        std::shared_ptr<Shard> shard;
+    };
+    // One entry per Metrics this thread has recorded into; ids are never
+    // reused, so an entry cannot be mistaken for a later object's
+    thread_local std::vector<Local> local;
+    for (const Local& entry : local) {
+        if (entry.owner == id_) {
+            return *entry.shard;
+        }
+    }
+
+    auto shard = std::make_shared<Shard>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_.push_back(shard);
+    }
+    // Shards whose Metrics is gone are only referenced from here
+    local.erase(std::remove_if(local.begin(), local.end(),
+                               [](const Local& entry) { return entry.shard.use_count() == 1; }),
+                local.end());
+    local.push_back({id_, shard});
+    return *shard;
+}
+
+void Metrics::recordLatency(MetricStage stage, std::chrono::nanoseconds elapsed) {
+#ifndef SECURITY_ANALYZER_NO_METRICS
+    const uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0));
+    Shard::Stage& out = shard().stages[stage];
+    bump(out.total_ns, ns);
+    if (ns > out.max_ns.load(std::memory_order_relaxed)) {
+        out.max_ns.store(ns, std::memory_order_relaxed);
+    }
+    bump(out.buckets[latencyBucket(ns)], 1);
+#else
+    (void)stage;
+    (void)elapsed;
+#endif
+}
+
+void Metrics::add(MetricCounter counter, uint64_t value) {
+#ifndef SECURITY_ANALYZER_NO_METRICS
+    bump(shard().counters[counter], value);
+#else
+    (void)counter;
+    (void)value;
+#endif
+}
+
+void Metrics::addCategoryMatches(size_t category, uint64_t value) {
+#ifndef SECURITY_ANALYZER_NO_METRICS
+    bump(shard().categories[std::min(category, MAX_METRIC_CATEGORIES - 1)], value);
+#else
+    (void)category;
+    (void)value;
+#endif
+}
+
+MetricsSnapshot Metrics::snapshot(const std::vector<std::string>& category_names) const {
+    MetricsSnapshot out;
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    std::array<uint64_t, MAX_METRIC_CATEGORIES> categories{};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& shard : shards_) {
+        for (size_t s = 0; s < STAGE_COUNT; ++s) {
+            const Shard::Stage& in = shard->stages[s];
+            StageMetrics& stage = out.stages[s];
+            stage.total_ns += in.total_ns.load(std::memory_order_relaxed);
+            stage.max_ns = std::max(stage.max_ns, in.max_ns.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < LATENCY_BUCKETS; ++b) {
+                const uint64_t n = in.buckets[b].load(std::memory_order_relaxed);
+                stage.buckets[b] += n;
+                stage.count += n;
+            }
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < MAX_METRIC_CATEGORIES; ++c) {
+            categories[c] += shard->categories[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    out.texts_analyzed = counters[COUNTER_TEXTS];
+    out.pdfs_analyzed = counters[COUNTER_PDFS];
+    out.bytes_scanned = counters[COUNTER_BYTES_SCANNED];
+    out.pages_extracted = counters[COUNTER_PAGES];
+    out.email_found = counters[COUNTER_EMAIL];
+    out.phone_found = counters[COUNTER_PHONE];
+    out.ssn_found = counters[COUNTER_SSN];
+    out.analyses_cut_short = counters[COUNTER_CUT_SHORT];
+    const size_t named = std::min(category_names.size(), MAX_METRIC_CATEGORIES);
+    for (size_t c = 0; c < named; ++c) {
+        out.category_matches.emplace_back(category_names[c], categories[c]);
+    }
+    return out;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Timed stages of an analysis
+enum MetricStage {
+    STAGE_ANALYZE_TEXT,      // a whole analyzeText call, cache lookups included
+    STAGE_ANALYZE_PDF,       // a whole analyzePDF call
+    STAGE_PDF_STRUCTURE,     // raw-byte structural pre-scan
+    STAGE_LOAD_PDF,          // Poppler parse
+    STAGE_EXTRACT_TEXT,      // text extraction, per page
+    STAGE_DETECT_PII,
+    STAGE_DETECT_MALICIOUS,
+    STAGE_COUNT
+};
+
+const char* stageName(MetricStage stage);
+
+enum MetricCounter {
+    COUNTER_TEXTS,            // texts analyzed, streams included
+    COUNTER_PDFS,             // analyzePDF calls
+    COUNTER_BYTES_SCANNED,    // bytes run through the detectors
+    COUNTER_PAGES,            // PDF pages extracted
+    COUNTER_EMAIL,            // analyses that found each kind of PII
+    COUNTER_PHONE,
+    COUNTER_SSN,
+    COUNTER_CUT_SHORT,        // analyses stopped by a deadline, byte limit or cancellation
+    COUNTER_COUNT
+};
+
+// Bucket b holds durations in [2^(b-1), 2^b) ns; bucket 0 is under 1 ns and
+// the last one is open-ended (2^38 ns is about 4.6 minutes)
+constexpr size_t LATENCY_BUCKETS = 40;
+// Categories past this index are counted in the last slot
+constexpr size_t MAX_METRIC_CATEGORIES = 64;
+
+struct StageMetrics {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    std::array<uint64_t, LATENCY_BUCKETS> buckets{};
+
+    // Upper bound of the bucket holding quantile q (0 to 1), capped at max_ns
+    uint64_t percentileNs(double q) const;
+};
+
+struct MetricsSnapshot {
+    std::array<StageMetrics, STAGE_COUNT> stages;
+    uint64_t texts_analyzed = 0;
+    uint64_t pdfs_analyzed = 0;
+    uint64_t bytes_scanned = 0;
+    uint64_t pages_extracted = 0;
+    uint64_t email_found = 0;
+    uint64_t phone_found = 0;
+    uint64_t ssn_found = 0;
+    uint64_t analyses_cut_short = 0;
+    // Per rule category, by issue text: distinct patterns matched, summed
+    // over analyses
+    std::vector<std::pair<std::string, uint64_t>> category_matches;
+};
+
+// Latency histograms and counters for one analyzer.
+//
+// Every thread records into its own shard, so the hot path takes no lock and
+// shares no cache line: a record is a thread_local lookup and a few relaxed
+// atomic stores that only that thread ever writes. snapshot() sums the shards
+// of all threads, including ones that have exited; the only lock is taken
+// when a thread records for the first time, and by snapshot().
+//
+// Category counters are indexed by category position; snapshot() names them
+// after whichever ruleset it is given.
+class Metrics {
+public:
+    Metrics();
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void recordLatency(MetricStage stage, std::chrono::nanoseconds elapsed);
+    void add(MetricCounter counter, uint64_t value = 1);
+    void addCategoryMatches(size_t category, uint64_t value);
+
+    MetricsSnapshot snapshot(const std::vector<std::string>& category_names) const;
+
+    struct Shard;
+
+private:
+    Shard& shard();
+
+    uint64_t id_;
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Shard>> shards_;
+};
+
+// Records the time from construction to destruction as one sample of stage.
+// Compiles to nothing when SECURITY_ANALYZER_NO_METRICS is defined.
+class StageTimer {
+public:
+#ifndef SECURITY_ANALYZER_NO_METRICS
+    StageTimer(Metrics& metrics, MetricStage stage)
+        : metrics_(metrics), stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() { metrics_.recordLatency(stage_, std::chrono::steady_clock::now() - start_); }
+#else
+    StageTimer(Metrics&, MetricStage) {}
+#endif
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+#ifndef SECURITY_ANALYZER_NO_METRICS
+private:
+    Metrics& metrics_;
+    MetricStage stage_;
+    std::chrono::steady_clock::time_point start_;
+#endif
+};
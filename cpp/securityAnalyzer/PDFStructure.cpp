@@ -0,0 +1,192 @@
+#include "PDFStructure.h"
+#include <cstdint>
+#include <string>
+
+namespace {
+
+bool isPDFWhitespace(unsigned char c) {
+    return c == 0x00 || c == '\t' || c == '\n' || c == '\f' || c == '\r' || c == ' ';
+}
+
+bool isPDFDelimiter(unsigned char c) {
+    switch (c) {
+        case '(': case ')': case '<': case '>': case '[': case ']':
+        case '{': case '}': case '/': case '%':
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isRegular(unsigned char c) {
+    return !isPDFWhitespace(c) && !isPDFDelimiter(c);
+}
+
+int hexValue(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Reads the name starting after the '/' at pos, decoding #xx escapes.
+// Returns the offset just past the name.
+size_t readName(std::string_view data, size_t pos, std::string& name) {
+    name.clear();
+    while (pos < data.size() && isRegular(static_cast<unsigned char>(data[pos]))) {
+        const unsigned char c = static_cast<unsigned char>(data[pos]);
+        if (c == '#' && pos + 2 < data.size()) {
+            const int hi = hexValue(static_cast<unsigned char>(data[pos + 1]));
+            const int lo = hexValue(static_cast<unsigned char>(data[pos + 2]));
+            if (hi >= 0 && lo >= 0) {
+                name.push_back(static_cast<char>(hi * 16 + lo));
+                pos += 3;
+                continue;
+            }
+        }
+        name.push_back(static_cast<char>(c));
+        ++pos;
+        // Only short names are of interest; skip the rest of long ones
+        if (name.size() > 16) {
+            while (pos < data.size() && isRegular(static_cast<unsigned char>(data[pos]))) {
+                ++pos;
+            }
+            break;
+        }
+    }
+    return pos;
+}
+
+void recordName(const std::string& name, PDFStructure& structure) {
+    if (name == "JavaScript" || name == "JS") {
+        structure.javascript = true;
+    } else if (name == "OpenAction") {
+        structure.open_action = true;
+    } else if (name == "Launch") {
+        structure.launch = true;
+    } else if (name == "EmbeddedFile" || name == "EmbeddedFiles") {
+        structure.embedded_file = true;
+    } else if (name == "AA") {
+        structure.additional_actions = true;
+    }
+}
+
+bool keywordAt(std::string_view data, size_t pos, std::string_view keyword) {
+    if (data.compare(pos, keyword.size(), keyword) != 0) {
+        return false;
+    }
+    const size_t end = pos + keyword.size();
+    const bool starts = pos == 0 || !isRegular(static_cast<unsigned char>(data[pos - 1]));
+    const bool ends = end == data.size() || !isRegular(static_cast<unsigned char>(data[end]));
+    return starts && ends;
+}
+
+// Offset just past the literal string whose '(' is at pos: parentheses
+// nest, and a backslash escapes the byte after it
+size_t skipLiteralString(std::string_view data, size_t pos) {
+    int depth = 0;
+    while (pos < data.size()) {
+        const char c = data[pos];
+        if (c == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')' && --depth == 0) {
+            return pos + 1;
+        }
+        ++pos;
+    }
+    return data.size();
+}
+
+size_t skipWhitespace(std::string_view data, size_t pos) {
+    while (pos < data.size() && isPDFWhitespace(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t skipDigits(std::string_view data, size_t pos) {
+    while (pos < data.size() && data[pos] >= '0' && data[pos] <= '9') {
+        ++pos;
+    }
+    return pos;
+}
+
+// "N G obj" at pos, as an xref stream or the target of startxref
+bool objectHeaderAt(std::string_view data, size_t pos) {
+    size_t p = skipDigits(data, pos);
+    if (p == pos || p >= data.size() || !isPDFWhitespace(static_cast<unsigned char>(data[p]))) {
+        return false;
+    }
+    size_t q = skipDigits(data, skipWhitespace(data, p));
+    if (q == p) {
+        return false;
+    }
+    q = skipWhitespace(data, q);
+    return keywordAt(data, q, "obj");
+}
+
+bool checkXref(std::string_view data) {
+    const size_t marker = data.rfind("startxref");
+    if (marker == std::string_view::npos) {
+        return false;
+    }
+    size_t pos = skipWhitespace(data, marker + 9);
+    const size_t digits_end = skipDigits(data, pos);
+    if (digits_end == pos || digits_end - pos > 12) {
+        return false;
+    }
+    const uint64_t offset = std::stoull(std::string(data.substr(pos, digits_end - pos)));
+    if (offset >= marker) {
+        return false;
+    }
+    const size_t target = skipWhitespace(data, static_cast<size_t>(offset));
+    return keywordAt(data, target, "xref") || objectHeaderAt(data, target);
+}
+
+} // namespace
+
+PDFStructure scanPDFStructure(std::string_view data) {
+    PDFStructure structure;
+    std::string name;
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const char c = data[pos];
+        if (c == '/') {
+            pos = readName(data, pos + 1, name);
+            recordName(name, structure);
+        } else if (c == '(') {
+            pos = skipLiteralString(data, pos);
+        } else if (c == '<') {
+            if (pos + 1 < data.size() && data[pos + 1] == '<') {
+                pos += 2;  // dictionary
+            } else {
+                const size_t end = data.find('>', pos + 1);
+                pos = end == std::string_view::npos ? data.size() : end + 1;
+            }
+        } else if (c == '%') {
+            // Comment: runs to the end of the line
+            while (pos < data.size() && data[pos] != '\r' && data[pos] != '\n') {
+                ++pos;
+            }
+        } else if (c == 'o' && keywordAt(data, pos, "obj")) {
+            ++structure.object_count;
+            pos += 3;
+        } else if (c == 's' && keywordAt(data, pos, "stream")) {
+            // Stream data is opaque (often compressed); resume after it
+            const size_t end = data.find("endstream", pos + 6);
+            pos = end == std::string_view::npos ? data.size() : end + 9;
+        } else {
+            ++pos;
+        }
+    }
+
+    structure.has_eof = data.rfind("%%EOF") != std::string_view::npos;
+    structure.has_startxref = data.rfind("startxref") != std::string_view::npos;
+    structure.xref_valid = checkXref(data);
+    return structure;
+}
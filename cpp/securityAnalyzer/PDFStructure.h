@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Structural facts about a PDF, read from its raw bytes without parsing it.
+//
+// Names are matched as whole PDF name tokens, with #xx escapes decoded (so
+// /J#61vaScript counts as /JavaScript but /JSON is not /JS). Literal
+// (...) and hex <...> strings and stream bodies are skipped, which keeps
+// their contents from producing false hits or hiding a '%' that would
+// otherwise start a comment; names inside compressed object streams are
+// therefore not seen here.
+struct PDFStructure {
+    bool javascript = false;          // /JavaScript or /JS
+    bool open_action = false;         // /OpenAction
+    bool launch = false;              // /Launch
+    bool embedded_file = false;       // /EmbeddedFile or /EmbeddedFiles
+    bool additional_actions = false;  // /AA
+    size_t object_count = 0;          // "N G obj" headers
+    // Findings only: a stale offset or a missing marker is common in benign
+    // files (naive edits, junk before the header) and Poppler repairs them
+    bool has_startxref = false;       // startxref keyword present
+    bool xref_valid = false;          // startxref points at an xref table or stream
+    bool has_eof = false;             // %%EOF marker present
+};
+
+PDFStructure scanPDFStructure(std::string_view data);
@@ -0,0 +1,156 @@
+#include "PatternEngine.h"
+#include <boost/regex.hpp>
+#include <algorithm>
+
+#ifdef SECURITY_ANALYZER_USE_RE2
+#include <re2/re2.h>
+#include <re2/set.h>
+#endif
+
+namespace {
+
+class BoostPatternEngine : public PatternEngine {
+public:
+    explicit BoostPatternEngine(const std::vector<std::string>& patterns) {
+        regexes_.reserve(patterns.size());
+        for (const auto& pattern : patterns) {
+            regexes_.emplace_back(pattern);
+        }
+    }
+
+    std::vector<bool> match(std::string_view text) const override {
+        std::vector<bool> matched(regexes_.size(), false);
+        for (size_t i = 0; i < regexes_.size(); ++i) {
+            matched[i] = boost::regex_search(text.begin(), text.end(), regexes_[i]);
+        }
+        return matched;
+    }
+
+    std::vector<RegexMatch> findAll(std::string_view text) const override {
+        std::vector<RegexMatch> matches;
+        for (size_t i = 0; i < regexes_.size(); ++i) {
+            boost::cregex_iterator it(text.data(), text.data() + text.size(), regexes_[i]);
+            for (; it != boost::cregex_iterator(); ++it) {
+                const size_t begin = static_cast<size_t>(it->position());
+                matches.push_back({static_cast<uint32_t>(i), begin, begin + static_cast<size_t>(it->length())});
+            }
+        }
+        return matches;
+    }
+
+    size_t patternCount() const override { return regexes_.size(); }
+    const char* name() const override { return "boost"; }
+
+private:
+    std::vector<boost::regex> regexes_;
+};
+
+#ifdef SECURITY_ANALYZER_USE_RE2
+class Re2PatternEngine : public PatternEngine {
+public:
+    explicit Re2PatternEngine(const RE2::Options& options)
+        : set_(options, RE2::UNANCHORED) {}
+
+    bool compile(const std::vector<std::string>& patterns, const RE2::Options& options) {
+        for (const auto& pattern : patterns) {
+            std::string error;
+            if (set_.Add(re2::StringPiece(pattern.data(), pattern.size()), &error) < 0) {
+                return false;
+            }
+            // The set only says which patterns occur; these locate them
+            regexes_.push_back(std::make_unique<RE2>(pattern, options));
+            if (!regexes_.back()->ok()) {
+                return false;
+            }
+        }
+        count_ = patterns.size();
+        return set_.Compile();
+    }
+
+    std::vector<bool> match(std::string_view text) const override {
+        std::vector<bool> matched(count_, false);
+        for (int index : matchingPatterns(re2::StringPiece(text.data(), text.size()))) {
+            matched[index] = true;
+        }
+        return matched;
+    }
+
+    std::vector<RegexMatch> findAll(std::string_view text) const override {
+        std::vector<RegexMatch> matches;
+        const re2::StringPiece input(text.data(), text.size());
+        std::vector<int> hits = matchingPatterns(input);
+        std::sort(hits.begin(), hits.end());
+        for (int index : hits) {
+            size_t pos = 0;
+            re2::StringPiece found;
+            while (pos <= text.size() &&
+                   regexes_[index]->Match(input, pos, text.size(), RE2::UNANCHORED, &found, 1)) {
+                const size_t begin = static_cast<size_t>(found.data() - text.data());
+                const size_t end = begin + found.size();
+                matches.push_back({static_cast<uint32_t>(index), begin, end});
+                pos = end > begin ? end : end + 1;
+            }
+        }
+        return matches;
+    }
+
+    size_t patternCount() const override { return count_; }
+    const char* name() const override { return "re2"; }
+
+private:
+    // Indices of the patterns that occur in input. The set's DFA can run out
+    // of memory on large inputs, which Match reports like no match; each
+    // regex is then run on its own, as RE2 falls back to the NFA rather
+    // than fail, so a failure never reads as "no PII".
+    std::vector<int> matchingPatterns(const re2::StringPiece& input) const {
+        std::vector<int> hits;
+        RE2::Set::ErrorInfo error{RE2::Set::kNoError};
+        if (set_.Match(input, &hits, &error) || error.kind == RE2::Set::kNoError) {
+            return hits;
+        }
+        hits.clear();
+        for (size_t i = 0; i < regexes_.size(); ++i) {
+            if (regexes_[i]->Match(input, 0, input.size(), RE2::UNANCHORED, nullptr, 0)) {
+                hits.push_back(static_cast<int>(i));
+            }
+        }
+        return hits;
+    }
+
+    RE2::Set set_;
+    std::vector<std::unique_ptr<RE2>> regexes_;
+    size_t count_ = 0;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<PatternEngine> makeBoostPatternEngine(const std::vector<std::string>& patterns) {
+    return std::make_unique<BoostPatternEngine>(patterns);
+}
+
+std::unique_ptr<PatternEngine> makeLinearPatternEngine(const std::vector<std::string>& patterns) {
+#ifdef SECURITY_ANALYZER_USE_RE2
+    // Match raw bytes: the patterns are ASCII, and Latin-1 mode never
+    // rejects or skips input that is not valid UTF-8, whatever its source
+    RE2::Options options;
+    options.set_encoding(RE2::Options::EncodingLatin1);
+    options.set_log_errors(false);
+    options.set_max_mem(64 << 20);
+
+    auto engine = std::make_unique<Re2PatternEngine>(options);
+    if (engine->compile(patterns, options)) {
+        return engine;
+    }
+#else
+    (void)patterns;
+#endif
+    return nullptr;
+}
+
+std::unique_ptr<PatternEngine> createPatternEngine(const std::vector<std::string>& patterns) {
+    if (auto engine = makeLinearPatternEngine(patterns)) {
+        return engine;
+    }
+    return makeBoostPatternEngine(patterns);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct RegexMatch {
+    uint32_t pattern;  // index into the engine's patterns
+    size_t begin;
+    size_t end;
+};
+
+// A compiled set of regular expressions matched together against a text.
+// Implementations are immutable once created and safe to share across threads.
+class PatternEngine {
+public:
+    virtual ~PatternEngine() = default;
+
+    // matched[i] is true if patterns[i] occurs anywhere in text
+    virtual std::vector<bool> match(std::string_view text) const = 0;
+    // Every non-overlapping occurrence of each pattern, grouped by pattern in
+    // order. Costs more than match(); only patterns that occur are located.
+    virtual std::vector<RegexMatch> findAll(std::string_view text) const = 0;
+
+    virtual size_t patternCount() const = 0;
+    virtual const char* name() const = 0;
+};
+
+// Backtracking engine, one regex_search per pattern. Always available.
+std::unique_ptr<PatternEngine> makeBoostPatternEngine(const std::vector<std::string>& patterns);
+
+// Linear-time engine matching every pattern in a single pass (RE2::Set).
+// Returns nullptr when the build has no RE2 support or a pattern uses syntax
+// RE2 does not accept (backreferences, lookaround).
+std::unique_ptr<PatternEngine> makeLinearPatternEngine(const std::vector<std::string>& patterns);
+
+// Linear-time engine when possible, Boost otherwise.
+std::unique_ptr<PatternEngine> createPatternEngine(const std::vector<std::string>& patterns);
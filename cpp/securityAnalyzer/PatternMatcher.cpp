@@ -0,0 +1,201 @@
+#include "PatternMatcher.h"
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kNoState = std::numeric_limits<uint32_t>::max();
+}
+
+uint32_t PatternMatcher::addPattern(const std::string& pattern) {
+    if (pattern.empty()) {
+        throw std::invalid_argument("PatternMatcher: empty pattern");
+    }
+    if (built_) {
+        throw std::logic_error("PatternMatcher: cannot add patterns after build()");
+    }
+    patterns_.push_back(pattern);
+    max_pattern_length_ = std::max(max_pattern_length_, pattern.size());
+    return static_cast<uint32_t>(patterns_.size() - 1);
+}
+
+void PatternMatcher::build() {
+    // Byte equivalence classes: every byte used by some pattern gets its own
+    // class, everything else collapses into class 0. Case-insensitive
+    // matchers give upper-case letters the class of their lower-case form.
+    auto fold = [this](unsigned char c) -> unsigned char {
+        return (case_insensitive_ && c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+    };
+    byte_class_.fill(0);
+    alphabet_size_ = 1;
+    for (const auto& pattern : patterns_) {
+        for (unsigned char c : pattern) {
+            if (byte_class_[fold(c)] == 0) {
+                byte_class_[fold(c)] = static_cast<uint16_t>(alphabet_size_++);
+            }
+        }
+    }
+    if (case_insensitive_) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            byte_class_[c] = byte_class_[fold(static_cast<unsigned char>(c))];
+        }
+    }
+
+    // Trie
+    delta_.assign(alphabet_size_, kNoState);
+    std::vector<std::vector<uint32_t>> own_outputs(1);
+    for (uint32_t id = 0; id < patterns_.size(); ++id) {
+        uint32_t state = 0;
+        for (unsigned char c : patterns_[id]) {
+            uint32_t& slot = delta_[state * alphabet_size_ + byte_class_[c]];
+            if (slot == kNoState) {
+                slot = static_cast<uint32_t>(own_outputs.size());
+                own_outputs.emplace_back();
+                delta_.resize(delta_.size() + alphabet_size_, kNoState);
+            }
+            // delta_ may have been reallocated by resize() above
+            state = delta_[state * alphabet_size_ + byte_class_[c]];
+        }
+        own_outputs[state].push_back(id);
+    }
+
+    // Failure links, folded into a complete transition table (BFS order
+    // guarantees a state's failure target is finished before the state).
+    const uint32_t state_count = static_cast<uint32_t>(own_outputs.size());
+    std::vector<uint32_t> fail(state_count, 0);
+    std::vector<uint32_t> order;
+    order.reserve(state_count);
+    std::queue<uint32_t> queue;
+
+    for (uint32_t c = 0; c < alphabet_size_; ++c) {
+        uint32_t& slot = delta_[c];
+        if (slot == kNoState) {
+            slot = 0;
+        } else {
+            fail[slot] = 0;
+            queue.push(slot);
+        }
+    }
+    while (!queue.empty()) {
+        const uint32_t state = queue.front();
+        queue.pop();
+        order.push_back(state);
+        for (uint32_t c = 0; c < alphabet_size_; ++c) {
+            uint32_t& slot = delta_[state * alphabet_size_ + c];
+            const uint32_t fallback = delta_[fail[state] * alphabet_size_ + c];
+            if (slot == kNoState) {
+                slot = fallback;
+            } else {
+                fail[slot] = fallback;
+                queue.push(slot);
+            }
+        }
+    }
+
+    // Merge each state's outputs with those reachable through its failure link
+    std::vector<std::vector<uint32_t>> merged(state_count);
+    for (uint32_t state : order) {
+        merged[state] = own_outputs[state];
+        const auto& inherited = merged[fail[state]];
+        merged[state].insert(merged[state].end(), inherited.begin(), inherited.end());
+    }
+
+    output_offsets_.assign(state_count + 1, 0);
+    outputs_.clear();
+    for (uint32_t state = 0; state < state_count; ++state) {
+        output_offsets_[state] = static_cast<uint32_t>(outputs_.size());
+        outputs_.insert(outputs_.end(), merged[state].begin(), merged[state].end());
+    }
+    output_offsets_[state_count] = static_cast<uint32_t>(outputs_.size());
+
+    delta_view_ = delta_.data();
+    output_offsets_view_ = output_offsets_.data();
+    outputs_view_ = outputs_.data();
+    state_count_ = state_count;
+    built_ = true;
+}
+
+PatternMatcher::Tables PatternMatcher::tables() const {
+    return {byte_class_.data(), alphabet_size_, state_count_, delta_view_, output_offsets_view_, outputs_view_};
+}
+
+void PatternMatcher::adopt(std::vector<std::string> patterns, const Tables& tables) {
+    if (built_) {
+        throw std::logic_error("PatternMatcher: already built");
+    }
+    if (tables.alphabet_size == 0 || tables.alphabet_size > 257 || tables.state_count == 0) {
+        throw std::invalid_argument("PatternMatcher: bad table dimensions");
+    }
+    for (int c = 0; c < 256; ++c) {
+        if (tables.byte_class[c] >= tables.alphabet_size) {
+            throw std::invalid_argument("PatternMatcher: byte class out of range");
+        }
+    }
+    // Every transition and output is checked once here, so scanning never
+    // needs bounds checks
+    const uint64_t cells = uint64_t{tables.state_count} * tables.alphabet_size;
+    for (uint64_t i = 0; i < cells; ++i) {
+        if (tables.delta[i] >= tables.state_count) {
+            throw std::invalid_argument("PatternMatcher: transition out of range");
+        }
+    }
+    if (tables.output_offsets[0] != 0) {
+        throw std::invalid_argument("PatternMatcher: bad output offsets");
+    }
+    for (uint32_t state = 0; state < tables.state_count; ++state) {
+        if (tables.output_offsets[state + 1] < tables.output_offsets[state]) {
+            throw std::invalid_argument("PatternMatcher: bad output offsets");
+        }
+    }
+    // A pattern reported at a state must fit in the shortest text reaching
+    // it, or its begin offset would underflow
+    std::vector<uint32_t> depth(tables.state_count, kNoState);
+    std::queue<uint32_t> queue;
+    depth[0] = 0;
+    queue.push(0);
+    while (!queue.empty()) {
+        const uint32_t state = queue.front();
+        queue.pop();
+        for (uint32_t c = 0; c < tables.alphabet_size; ++c) {
+            const uint32_t target = tables.delta[state * tables.alphabet_size + c];
+            if (depth[target] == kNoState) {
+                depth[target] = depth[state] + 1;
+                queue.push(target);
+            }
+        }
+    }
+    for (uint32_t state = 0; state < tables.state_count; ++state) {
+        for (uint32_t k = tables.output_offsets[state]; k < tables.output_offsets[state + 1]; ++k) {
+            if (tables.outputs[k] >= patterns.size() || patterns[tables.outputs[k]].size() > depth[state]) {
+                throw std::invalid_argument("PatternMatcher: bad output");
+            }
+        }
+    }
+
+    patterns_.clear();
+    max_pattern_length_ = 0;
+    for (auto& pattern : patterns) {
+        if (pattern.empty()) {
+            throw std::invalid_argument("PatternMatcher: empty pattern");
+        }
+        max_pattern_length_ = std::max(max_pattern_length_, pattern.size());
+        patterns_.push_back(std::move(pattern));
+    }
+    std::copy(tables.byte_class, tables.byte_class + 256, byte_class_.begin());
+    alphabet_size_ = tables.alphabet_size;
+    delta_view_ = tables.delta;
+    output_offsets_view_ = tables.output_offsets;
+    outputs_view_ = tables.outputs;
+    state_count_ = tables.state_count;
+    built_ = true;
+}
+
+std::vector<PatternMatch> PatternMatcher::findAll(std::string_view text) const {
+    std::vector<PatternMatch> matches;
+    scan(text, [&matches](uint32_t id, size_t begin, size_t end) {
+        matches.push_back({id, begin, end});
+        return true;
+    });
+    return matches;
+}
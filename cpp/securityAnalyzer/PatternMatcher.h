@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct PatternMatch {
+    uint32_t pattern_id;
+    size_t begin;
+    size_t end;
+};
+
+// Aho-Corasick automaton over a fixed set of byte patterns.
+//
+// Patterns are added, then build() compiles them into a dense DFA over byte
+// equivalence classes. After build() the matcher is immutable and scan() may
+// be called concurrently from any number of threads.
+//
+// A case-insensitive matcher folds ASCII letters into shared byte classes, so
+// it scans the original text directly without a lowercased copy.
+class PatternMatcher {
+public:
+    explicit PatternMatcher(bool case_insensitive = false)
+        : case_insensitive_(case_insensitive) {}
+
+    // Moves keep the tables in place; copies would not, so there are none
+    PatternMatcher(PatternMatcher&&) = default;
+    PatternMatcher& operator=(PatternMatcher&&) = default;
+    PatternMatcher(const PatternMatcher&) = delete;
+    PatternMatcher& operator=(const PatternMatcher&) = delete;
+
+    // Returns the id of the new pattern. Ids are assigned sequentially from 0.
+    uint32_t addPattern(const std::string& pattern);
+    void build();
+
+    bool caseInsensitive() const { return case_insensitive_; }
+    size_t patternCount() const { return patterns_.size(); }
+    size_t maxPatternLength() const { return max_pattern_length_; }
+    const std::string& pattern(uint32_t id) const { return patterns_[id]; }
+
+    // Calls on_match(pattern_id, begin, end) for every occurrence of every
+    // pattern, in order of end offset. Scanning stops early if on_match
+    // returns false.
+    template <typename Callback>
+    void scan(std::string_view text, Callback&& on_match) const;
+
+    // Resumable scan() for text that arrives in pieces. state starts at 0 and
+    // is carried from one chunk to the next, so matches spanning a chunk
+    // boundary are still reported. Offsets are relative to the whole stream,
+    // in which this chunk starts at stream_offset. Returns false if on_match
+    // stopped the scan.
+    template <typename Callback>
+    bool scanChunk(std::string_view chunk, uint32_t& state, size_t stream_offset,
+                   Callback&& on_match) const;
+
+    std::vector<PatternMatch> findAll(std::string_view text) const;
+
+    // The compiled automaton as flat arrays, as stored in a ruleset file
+    struct Tables {
+        const uint16_t* byte_class;      // 256 entries
+        uint32_t alphabet_size;
+        uint32_t state_count;
+        const uint32_t* delta;           // state_count * alphabet_size
+        const uint32_t* output_offsets;  // state_count + 1
+        const uint32_t* outputs;         // output_offsets[state_count]
+    };
+    // Only valid after build() or adopt()
+    Tables tables() const;
+    // Takes the place of addPattern() and build(): uses tables produced by
+    // tables() in place, without copying or rebuilding them. The memory must
+    // outlive the matcher. Throws std::invalid_argument if the tables are
+    // inconsistent with each other or with patterns.
+    void adopt(std::vector<std::string> patterns, const Tables& tables);
+
+private:
+    uint32_t next(uint32_t state, unsigned char c) const {
+        return delta_view_[state * alphabet_size_ + byte_class_[c]];
+    }
+
+    bool case_insensitive_;
+    std::vector<std::string> patterns_;
+    size_t max_pattern_length_ = 0;
+    bool built_ = false;
+
+    // Bytes that occur in no pattern share class 0.
+    std::array<uint16_t, 256> byte_class_{};
+    uint32_t alphabet_size_ = 1;
+
+    // delta_[state * alphabet_size_ + class] -> next state
+    std::vector<uint32_t> delta_;
+    // Patterns ending at a state (including via failure links) are
+    // outputs_[output_offsets_[state] .. output_offsets_[state + 1]).
+    std::vector<uint32_t> output_offsets_;
+    std::vector<uint32_t> outputs_;
+    // What scanning reads: the vectors above, or adopted memory
+    const uint32_t* delta_view_ = nullptr;
+    const uint32_t* output_offsets_view_ = nullptr;
+    const uint32_t* outputs_view_ = nullptr;
+    uint32_t state_count_ = 0;
+};
+
+template <typename Callback>
+void PatternMatcher::scan(std::string_view text, Callback&& on_match) const {
+    uint32_t state = 0;
+    scanChunk(text, state, 0, std::forward<Callback>(on_match));
+}
+
+template <typename Callback>
+bool PatternMatcher::scanChunk(std::string_view chunk, uint32_t& state, size_t stream_offset,
+                               Callback&& on_match) const {
+    if (!built_) {
+        return true;
+    }
+
+    for (size_t i = 0; i < chunk.size(); ++i) {
+        state = next(state, static_cast<unsigned char>(chunk[i]));
+        for (uint32_t k = output_offsets_view_[state]; k < output_offsets_view_[state + 1]; ++k) {
+            const uint32_t id = outputs_view_[k];
+            const size_t end = stream_offset + i + 1;
+            if (!on_match(id, end - patterns_[id].size(), end)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,160 @@
+#include "ResultCache.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+
+uint64_t rotl(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+struct SipState {
+    uint64_t v0, v1, v2, v3;
+
+    void rounds(int count) {
+        for (int i = 0; i < count; ++i) {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        }
+    }
+    void absorb(uint64_t m) {
+        v3 ^= m;
+        rounds(2);
+        v0 ^= m;
+    }
+};
+
+// Little-endian on every platform we build for; the key is per process, so
+// the hash never has to agree across machines anyway
+uint64_t load64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+struct SipKey {
+    uint64_t k0, k1;
+};
+
+const SipKey& processKey() {
+    static const SipKey key = [] {
+        std::random_device device;
+        std::uniform_int_distribution<uint64_t> word;
+        return SipKey{word(device), word(device)};
+    }();
+    return key;
+}
+
+size_t resultBytes(const AnalysisResult& result) {
+    return sizeof(AnalysisResult) + result.analysis_summary.capacity() +
+           result.issues.capacity() * sizeof(Issue) + result.spans.capacity() * sizeof(Span) +
+           result.error.capacity();
+}
+
+} // namespace
+
+void hashContent(std::string_view data, uint64_t& lo, uint64_t& hi) {
+    const SipKey& key = processKey();
+    SipState s{0x736f6d6570736575ULL ^ key.k0, 0x646f72616e646f6dULL ^ key.k1,
+               0x6c7967656e657261ULL ^ key.k0, 0x7465646279746573ULL ^ key.k1};
+    s.v1 ^= 0xee;  // 128-bit output variant
+
+    const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t blocks = data.size() / 8;
+    for (size_t i = 0; i < blocks; ++i, p += 8) {
+        s.absorb(load64(p));
+    }
+    uint64_t last = static_cast<uint64_t>(data.size()) << 56;
+    for (size_t i = 0; i < data.size() % 8; ++i) {
+        last |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    s.absorb(last);
+
+    s.v2 ^= 0xee;
+    s.rounds(4);
+    lo = s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+    s.v1 ^= 0xdd;
+    s.rounds(4);
+    hi = s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+}
+
+ResultCache::ResultCache(size_t byte_budget, size_t shard_count) {
+    shard_count = std::max<size_t>(shard_count, 1);
+    shard_budget_ = byte_budget / shard_count;
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+bool ResultCache::lookup(const CacheKey& key, AnalysisResult& out) {
+    Shard& shard = shardFor(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            out = it->second->result;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::insert(const CacheKey& key, const AnalysisResult& result, uint64_t generation) {
+    const size_t bytes = resultBytes(result) + sizeof(Entry);
+    if (bytes > shard_budget_) {
+        return;
+    }
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // A clear() that bumped the generation empties this shard after taking
+    // its lock, so an entry that passes this check is cleared with the rest
+    if (generation_.load() != generation) {
+        return;
+    }
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end()) {
+        shard.bytes -= existing->second->bytes;
+        shard.lru.erase(existing->second);
+        shard.index.erase(existing);
+    }
+    shard.lru.push_front(Entry{key, result, bytes});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += bytes;
+
+    while (shard.bytes > shard_budget_) {
+        const Entry& oldest = shard.lru.back();
+        shard.bytes -= oldest.bytes;
+        shard.index.erase(oldest.key);
+        shard.lru.pop_back();
+    }
+}
+
+void ResultCache::clear() {
+    generation_.fetch_add(1);
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+CacheStats ResultCache::stats() const {
+    CacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        stats.entries += shard->lru.size();
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "SecurityAnalyzer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Identity of one analysis: the content hash plus everything else that
+// changes the result. Keys compare in full, never by hash alone.
+struct CacheKey {
+    uint64_t hash_lo = 0;
+    uint64_t hash_hi = 0;
+    uint64_t size = 0;
+    uint64_t threshold_bits = 0;
+    uint64_t variant = 0;  // text vs. PDF, and the PDF scan options
+    uint64_t ruleset_version = 0;
+
+    bool operator==(const CacheKey& other) const {
+        return hash_lo == other.hash_lo && hash_hi == other.hash_hi && size == other.size &&
+               threshold_bits == other.threshold_bits && variant == other.variant &&
+               ruleset_version == other.ruleset_version;
+    }
+};
+
+// 128-bit SipHash-2-4 of data under a random per-process key. Only
+// equality matters for the cache; the key keeps collisions from being
+// precomputed, since a forged hit would hand out another document's verdict.
+void hashContent(std::string_view data, uint64_t& lo, uint64_t& hi);
+
+// LRU cache of analysis results under a byte budget, split into
+// independently locked shards so concurrent lookups rarely contend.
+class ResultCache {
+public:
+    explicit ResultCache(size_t byte_budget, size_t shard_count = 16);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Copies the cached result into out and marks it most recently used
+    bool lookup(const CacheKey& key, AnalysisResult& out);
+    // Results larger than one shard's budget are not stored, nor results
+    // computed across a clear(): generation is the value of generation()
+    // read before the analysis started
+    void insert(const CacheKey& key, const AnalysisResult& result, uint64_t generation);
+    // Drops every entry, and with them the rulesets their results hold
+    void clear();
+    uint64_t generation() const { return generation_.load(); }
+
+    CacheStats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const CacheKey& key) const { return static_cast<size_t>(key.hash_lo); }
+    };
+    struct Entry {
+        CacheKey key;
+        AnalysisResult result;
+        size_t bytes;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;  // most recent first
+        std::unordered_map<CacheKey, std::list<Entry>::iterator, KeyHash> index;
+        size_t bytes = 0;
+    };
+
+    Shard& shardFor(const CacheKey& key) {
+        return *shards_[(key.hash_hi >> 32) % shards_.size()];
+    }
+
+    size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> generation_{0};  // bumped by clear()
+};
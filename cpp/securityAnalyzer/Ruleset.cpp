@@ -0,0 +1,523 @@
+#include "Ruleset.h"
+#include "MappedFile.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+const char* const KEYWORD_ISSUE = "harmful_keyword_detected";
+
+namespace {
+
+// Regular expressions for PII detection
+const char* const email_pattern = R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})";
+// Very strict phone pattern: require clear phone number formatting with proper separators
+const char* const phone_pattern = R"(\b(?:\+1[\s\-\.]?)?(?:\([2-9]\d{2}\)[\s\-\.]?|[2-9]\d{2}[\s\-\.])[2-9]\d{2}[\s\-\.]\d{4}\b|\b(?:\+\d{1,3}[\s\-\.])?(?:\d{3}[\s\-\.]\d{3}[\s\-\.]\d{4})\b)";
+const char* const ssn_pattern = R"(\b\d{3}-\d{2}-\d{4}\b)";
+
+bool isWordByte(unsigned char c) {
+    // Bytes of multi-byte UTF-8 sequences count as letters
+    return c >= 0x80 || std::isalnum(c) || c == '_';
+}
+
+RuleCategory parseCategory(const nlohmann::json& entry) {
+    RuleCategory category;
+    category.issue = entry.at("issue").get<std::string>();
+    category.patterns = entry.at("patterns").get<std::vector<std::string>>();
+    category.whole_word = entry.value("whole_word", false);
+    category.case_sensitive = entry.value("case_sensitive", false);
+    category.report_each_pattern = entry.value("report_each_pattern", false);
+    category.weight = entry.value("weight", category.weight);
+    const auto pattern_weights = entry.find("pattern_weights");
+    if (pattern_weights != entry.end()) {
+        category.pattern_weights.assign(category.patterns.size(), category.weight);
+        for (const auto& [pattern, weight] : pattern_weights->items()) {
+            const auto it = std::find(category.patterns.begin(), category.patterns.end(), pattern);
+            if (it == category.patterns.end()) {
+                throw std::runtime_error("pattern_weights names unknown pattern \"" + pattern + "\"");
+            }
+            category.pattern_weights[it - category.patterns.begin()] = weight.get<double>();
+        }
+    }
+    return category;
+}
+
+// The PII patterns are fixed, so one compiled engine serves every ruleset
+std::shared_ptr<const PatternEngine> sharedPiiEngine() {
+    static const std::shared_ptr<const PatternEngine> engine =
+        createPatternEngine({email_pattern, phone_pattern, ssn_pattern});
+    return engine;
+}
+
+uint16_t toFixedWeight(double weight) {
+    if (!(weight >= 0.0 && weight <= 1.0)) {
+        throw std::invalid_argument("Ruleset: weight outside [0, 1]");
+    }
+    return static_cast<uint16_t>(std::lround(weight * Ruleset::WEIGHT_SCALE));
+}
+
+bool isTriggerByte(unsigned char c) {
+    return c < 0x80 && std::ispunct(c);
+}
+
+std::atomic<uint64_t> next_version{1};
+
+// Compiled ruleset file: a header, the categories, then the tables of the
+// full and the plain matcher. Integers are in the writer's byte order and
+// the uint32 tables are 4-byte aligned so they can be used in place.
+const char RULESET_MAGIC[8] = {'S', 'A', 'R', 'U', 'L', 'E', 'S', '\0'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Category flag bits
+const uint32_t CATEGORY_REPORT_EACH = 1;
+const uint32_t CATEGORY_CASE_SENSITIVE = 2;
+const uint32_t CATEGORY_WHOLE_WORD = 4;
+const uint32_t CATEGORY_PATTERN_WEIGHTS = 8;
+
+class FileWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        out_.append(reinterpret_cast<const char*>(&value), sizeof value);
+    }
+    void putString(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        out_ += value;
+    }
+    template <typename T>
+    void putArray(const T* data, size_t count) {
+        out_.resize((out_.size() + 3) & ~size_t{3}, '\0');
+        out_.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+    }
+    void putMatcher(const PatternMatcher& matcher) {
+        const auto tables = matcher.tables();
+        const uint32_t output_count = tables.output_offsets[tables.state_count];
+        put(tables.alphabet_size);
+        put(tables.state_count);
+        put(output_count);
+        putArray(tables.byte_class, 256);
+        putArray(tables.delta, size_t{tables.state_count} * tables.alphabet_size);
+        putArray(tables.output_offsets, size_t{tables.state_count} + 1);
+        putArray(tables.outputs, output_count);
+    }
+    const std::string& bytes() const { return out_; }
+
+private:
+    std::string out_;
+};
+
+// Bounds-checked cursor over a mapped file; throws std::runtime_error on
+// truncated input
+class FileReader {
+public:
+    explicit FileReader(std::string_view data) : data_(data) {}
+
+    std::string_view take(size_t size) {
+        if (size > data_.size() - pos_) {
+            throw std::runtime_error("truncated");
+        }
+        std::string_view bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return bytes;
+    }
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, take(sizeof value).data(), sizeof value);
+        return value;
+    }
+    std::string getString() {
+        return std::string(take(get<uint32_t>()));
+    }
+    template <typename T>
+    const T* getArray(uint64_t count) {
+        pos_ = std::min((pos_ + 3) & ~size_t{3}, data_.size());
+        if (count > (data_.size() - pos_) / sizeof(T)) {
+            throw std::runtime_error("truncated");
+        }
+        return reinterpret_cast<const T*>(take(count * sizeof(T)).data());
+    }
+    PatternMatcher::Tables getMatcher() {
+        PatternMatcher::Tables tables;
+        tables.alphabet_size = get<uint32_t>();
+        tables.state_count = get<uint32_t>();
+        const uint32_t output_count = get<uint32_t>();
+        tables.byte_class = getArray<uint16_t>(256);
+        tables.delta = getArray<uint32_t>(uint64_t{tables.state_count} * tables.alphabet_size);
+        tables.output_offsets = getArray<uint32_t>(uint64_t{tables.state_count} + 1);
+        tables.outputs = getArray<uint32_t>(output_count);
+        if (tables.state_count == 0 || tables.output_offsets[tables.state_count] != output_count) {
+            throw std::runtime_error("inconsistent matcher tables");
+        }
+        return tables;
+    }
+    bool atEnd() const { return pos_ == data_.size(); }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+// Weights are graded by how much a single match says: an injection
+// payload is rarely innocent, while exec( or base64 turn up in ordinary
+// code and prose
+std::vector<RuleCategory> Ruleset::builtinCategories() {
+    return {
+        // SQL Injection patterns (comprehensive)
+        {"Potential SQL injection attempt detected", false, false, {
+            "' or '", "' or 1=1", "' or 1=1--", "' or '1'='1", "' or \"1\"=\"1",
+            "' union select", "union all select", "' having '", "' group by '",
+            "' order by ", "' drop table", "'; drop table", "' delete from", "' insert into",
+            "' update ", "' alter table", "' create table", "' truncate ",
+            "'; exec", "'; execute", "xp_cmdshell", "sp_executesql",
+            "benchmark(", "sleep(", "waitfor delay", "pg_sleep(",
+            "extractvalue(", "updatexml(", "load_file(", "into outfile",
+            "information_schema", "mysql.user", "sysobjects", "syscolumns"
+        }, false, 0.6},
+        // XSS/JavaScript injection patterns (comprehensive)
+        {"Potential XSS attack detected", false, false, {
+            "<script", "</script>", "javascript:", "vbscript:", "onload=", "onerror=",
+            "onclick=", "onmouseover=", "onfocus=", "onblur=", "onchange=",
+            "onsubmit=", "onreset=", "onkeydown=", "onkeyup=", "onkeypress=",
+            "document.cookie", "document.write", "window.location", "eval(",
+            "settimeout(", "setinterval(", "innerhtml=", "outerhtml=",
+            "document.getelementbyid", "alert(", "confirm(", "prompt(",
+            "fromcharcode(", "unescape(", "string.fromcharcode"
+        }, false, 0.6},
+        // Command injection patterns (comprehensive)
+        {"Potential command injection attempt detected", false, false, {
+            "; rm -rf", "; del ", "& echo", "| nc ", "| netcat", "; wget",
+            "; curl", "; cat /etc/passwd", "; cat /etc/shadow", "$(", "`",
+            "; ls -la", "; dir", "; whoami", "; id", "; uname", "; ps aux",
+            "; netstat", "; ifconfig", "; ping", "; nslookup", "; dig",
+            "; chmod +x", "; ./", "&&", "||", "; sh", "; bash", "; cmd",
+            "; powershell", "& type", "& copy", "& move", "& ren"
+        }, false, 0.5},
+        // NoSQL injection patterns
+        {"Potential NoSQL injection attempt detected", false, false, {
+            "$where", "$ne", "$in", "$nin", "$regex", "$exists", "$elemMatch",
+            "$gt", "$gte", "$lt", "$lte", "$or", "$and", "$not", "$nor",
+            "this.password", "this.username", "db.eval", "mapreduce",
+            "return true", "return false", "; return ", "var x=", "var y="
+        }, false, 0.4},
+        // LDAP injection patterns
+        {"Potential LDAP injection attempt detected", false, false, {
+            ")(cn=*", ")(uid=*", ")(mail=*", ")(&", ")(|", "*)(uid=*",
+            "*)(cn=*", "admin*", "*admin", ")(objectclass=*"
+        }, false, 0.4},
+        // Path traversal patterns
+        {"Potential path traversal attempt detected", false, false, {
+            "../", "..\\", "%2e%2e%2f", "%2e%2e%5c", "....//", "....\\\\",
+            "/etc/passwd", "/etc/shadow", "/etc/hosts", "c:\\windows\\system32",
+            "boot.ini", "web.config", ".env", ".htaccess", "/proc/self/environ"
+        }, false, 0.5},
+        // XML/XXE injection patterns
+        {"Potential XML/XXE injection attempt detected", false, false, {
+            "<!entity", "<!doctype", "system \"file://", "system \"http://",
+            "system \"ftp://", "%xxe;", "&xxe;", "xml version=", "<?xml"
+        }, false, 0.4},
+        // Template injection patterns
+        {"Potential template injection attempt detected", false, true, {
+            "{{", "}}", "${", "#{", "<%", "%>", "@{", "[[", "]]",
+            "__import__", "getattr(", "setattr(", "__builtins__",
+            "exec(", "eval(", "compile(", "__globals__"
+        }, false, 0.3},
+        // Code execution function patterns (comprehensive)
+        {"Potential code execution attempt detected: ", true, false, {
+            // PHP functions
+            "system(", "exec(", "shell_exec(", "passthru(", "popen(",
+            "proc_open(", "eval(", "base64_decode", "file_get_contents(",
+            "fopen(", "fwrite(", "unlink(", "chmod(", "chown(", "mkdir(",
+            "rmdir(", "symlink(", "readfile(", "include(", "require(",
+            "preg_replace(", "create_function(", "call_user_func(",
+
+            // Python functions
+            "__import__(", "getattr(", "setattr(", "hasattr(", "delattr(",
+            "globals(", "locals(", "vars(", "dir(", "compile(", "execfile(",
+            "input(", "raw_input(", "open(", "file(", "__builtins__",
+
+            // JavaScript functions
+            "function(", "new function", "constructor(", "apply(", "call(",
+            "bind(", "with(", "delete ", "void(", "typeof ",
+
+            // System commands
+            "cmd.exe", "/bin/sh", "/bin/bash", "powershell.exe", "sh.exe",
+            "bash.exe", "python.exe", "perl.exe", "ruby.exe", "java.exe",
+
+            // Network functions
+            "curl(", "wget(", "fetch(", "xmlhttprequest", "ajax(",
+            "socket(", "connect(", "bind(", "listen(", "accept("
+        }, false, 0.25},
+        // Additional suspicious patterns
+        {"Suspicious function detected: ", true, false, {
+            "base64", "hex2bin", "bin2hex", "rot13", "str_rot13",
+            "gzinflate(", "gzuncompress(", "bzdecompress(",
+            "mcrypt_decrypt(", "openssl_decrypt(", "password_verify(",
+            "crypt(", "md5(", "sha1(", "hash(", "hash_hmac("
+        }, false, 0.1}
+    };
+}
+
+Ruleset::Ruleset()
+    : version_(next_version.fetch_add(1)),
+      pii_engine_(sharedPiiEngine()) {}
+
+Ruleset::Ruleset(std::vector<RuleCategory> categories) : Ruleset() {
+    categories_ = std::move(categories);
+    indexRules();
+    for (uint32_t id = 0; id < rules_.size(); ++id) {
+        matcher_.addPattern(pattern(id));
+    }
+    for (uint32_t id : plain_ids_) {
+        plain_matcher_.addPattern(pattern(id));
+    }
+    matcher_.build();
+    plain_matcher_.build();
+}
+
+// Fills rules_, triggers_, plain_ids_ and the compiled weights from
+// categories_. Pattern ids run through the categories in order.
+void Ruleset::indexRules() {
+    malicious_cap_ = toFixedWeight(malicious_weight_);
+    uint32_t all_categories = 0;
+    for (uint32_t c = 0; c < categories_.size(); ++c) {
+        const auto& category = categories_[c];
+        const auto& patterns = category.patterns;
+        if (!category.pattern_weights.empty() && category.pattern_weights.size() != patterns.size()) {
+            throw std::invalid_argument("Ruleset: pattern_weights does not match patterns");
+        }
+        const uint16_t category_weight = toFixedWeight(category.weight);
+        uint32_t heaviest = 0;
+        for (uint32_t i = 0; i < patterns.size(); ++i) {
+            const uint32_t id = static_cast<uint32_t>(rules_.size());
+            rules_.push_back({c, i});
+            const uint16_t weight = category.pattern_weights.empty()
+                                        ? category_weight
+                                        : toFixedWeight(category.pattern_weights[i]);
+            pattern_weights_.push_back(weight);
+            heaviest = std::max<uint32_t>(heaviest, weight);
+
+            bool plain = true;
+            for (unsigned char ch : patterns[i]) {
+                if (isTriggerByte(ch)) {
+                    triggers_.add(ch);
+                    plain = false;
+                }
+            }
+            if (plain) {
+                plain_ids_.push_back(id);
+            }
+        }
+        all_categories += heaviest;
+    }
+    max_deduction_ = std::min(malicious_cap_, all_categories);
+}
+
+std::shared_ptr<const Ruleset> Ruleset::compile(std::vector<RuleCategory> categories) {
+    return std::shared_ptr<const Ruleset>(new Ruleset(std::move(categories)));
+}
+
+std::shared_ptr<const Ruleset> Ruleset::builtin() {
+    static const std::shared_ptr<const Ruleset> ruleset = compile(builtinCategories());
+    return ruleset;
+}
+
+std::shared_ptr<const Ruleset> Ruleset::load(const std::vector<std::string>& rule_files) {
+    std::vector<RuleCategory> categories = builtinCategories();
+    for (const auto& path : rule_files) {
+        for (auto& category : loadRuleCategories(path)) {
+            categories.push_back(std::move(category));
+        }
+    }
+    return compile(std::move(categories));
+}
+
+void Ruleset::save(const std::string& path) const {
+    FileWriter out;
+    out.put(RULESET_MAGIC);
+    out.put(FILE_FORMAT_VERSION);
+    out.put(BYTE_ORDER_MARK);
+    out.put(malicious_weight_);
+    out.put(pii_weight_);
+    out.put(static_cast<uint32_t>(categories_.size()));
+    for (const auto& category : categories_) {
+        const uint32_t flags = (category.report_each_pattern ? CATEGORY_REPORT_EACH : 0u) |
+                               (category.case_sensitive ? CATEGORY_CASE_SENSITIVE : 0u) |
+                               (category.whole_word ? CATEGORY_WHOLE_WORD : 0u) |
+                               (category.pattern_weights.empty() ? 0u : CATEGORY_PATTERN_WEIGHTS);
+        out.put(flags);
+        out.put(category.weight);
+        out.putString(category.issue);
+        out.put(static_cast<uint32_t>(category.patterns.size()));
+        for (const auto& pattern : category.patterns) {
+            out.putString(pattern);
+        }
+        for (double weight : category.pattern_weights) {
+            out.put(weight);
+        }
+    }
+    out.putMatcher(matcher_);
+    out.putMatcher(plain_matcher_);
+
+    // Write a temporary file and rename it, so a worker opening path never
+    // sees a partial file
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(out.bytes().data(), static_cast<std::streamsize>(out.bytes().size()));
+        if (!file.flush()) {
+            throw std::runtime_error("Cannot write ruleset file: " + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Cannot write ruleset file: " + path);
+    }
+}
+
+std::shared_ptr<const Ruleset> Ruleset::open(const std::string& path) {
+    auto mapping = std::make_shared<const MappedFile>(path, MappedFile::TABLES);
+    std::shared_ptr<Ruleset> ruleset(new Ruleset());
+    try {
+        FileReader in(mapping->text());
+        if (in.take(sizeof RULESET_MAGIC) != std::string_view(RULESET_MAGIC, sizeof RULESET_MAGIC)) {
+            throw std::runtime_error("not a compiled ruleset");
+        }
+        if (in.get<uint32_t>() != FILE_FORMAT_VERSION) {
+            throw std::runtime_error("unsupported format version");
+        }
+        if (in.get<uint32_t>() != BYTE_ORDER_MARK) {
+            throw std::runtime_error("written with another byte order");
+        }
+        ruleset->malicious_weight_ = in.get<double>();
+        ruleset->pii_weight_ = in.get<double>();
+
+        const uint32_t category_count = in.get<uint32_t>();
+        for (uint32_t c = 0; c < category_count; ++c) {
+            RuleCategory category;
+            const uint32_t flags = in.get<uint32_t>();
+            category.report_each_pattern = (flags & CATEGORY_REPORT_EACH) != 0;
+            category.case_sensitive = (flags & CATEGORY_CASE_SENSITIVE) != 0;
+            category.whole_word = (flags & CATEGORY_WHOLE_WORD) != 0;
+            category.weight = in.get<double>();
+            category.issue = in.getString();
+            const uint32_t pattern_count = in.get<uint32_t>();
+            for (uint32_t i = 0; i < pattern_count; ++i) {
+                category.patterns.push_back(in.getString());
+            }
+            if (flags & CATEGORY_PATTERN_WEIGHTS) {
+                for (uint32_t i = 0; i < pattern_count; ++i) {
+                    category.pattern_weights.push_back(in.get<double>());
+                }
+            }
+            ruleset->categories_.push_back(std::move(category));
+        }
+        ruleset->indexRules();
+
+        std::vector<std::string> patterns;
+        for (uint32_t id = 0; id < ruleset->rules_.size(); ++id) {
+            patterns.push_back(ruleset->pattern(id));
+        }
+        std::vector<std::string> plain_patterns;
+        for (uint32_t id : ruleset->plain_ids_) {
+            plain_patterns.push_back(ruleset->pattern(id));
+        }
+        ruleset->matcher_.adopt(std::move(patterns), in.getMatcher());
+        ruleset->plain_matcher_.adopt(std::move(plain_patterns), in.getMatcher());
+        if (!in.atEnd()) {
+            throw std::runtime_error("trailing data");
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Invalid ruleset file " + path + ": " + e.what());
+    }
+    ruleset->mapping_ = std::move(mapping);
+    return ruleset;
+}
+
+bool Ruleset::confirm(uint32_t id, std::string_view text, size_t begin, size_t end) const {
+    const RuleCategory& category = categories_[rules_[id].category];
+    const std::string& expected = pattern(id);
+    if (category.case_sensitive && text.substr(begin, end - begin) != expected) {
+        return false;
+    }
+    if (category.whole_word) {
+        if (isWordByte(expected.front()) && begin > 0 && isWordByte(text[begin - 1])) {
+            return false;
+        }
+        if (isWordByte(expected.back()) && end < text.size() && isWordByte(text[end])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RuleProfile::RuleProfile(std::shared_ptr<const Ruleset> rules, const std::vector<std::string>& categories,
+                         const std::unordered_map<std::string, double>& weights, bool detect_pii)
+    : rules_(std::move(rules)),
+      version_(next_version.fetch_add(1)),
+      enabled_((rules_->categories().size() + 63) / 64, 0),
+      category_weights_(rules_->categories().size(), RULESET_WEIGHT),
+      detect_pii_(detect_pii) {
+    for (const auto& [issue, weight] : weights) {
+        toFixedWeight(weight);
+    }
+    for (uint32_t c = 0; c < rules_->categories().size(); ++c) {
+        const std::string& issue = rules_->categories()[c].issue;
+        if (categories.empty() || std::find(categories.begin(), categories.end(), issue) != categories.end()) {
+            enabled_[c >> 6] |= uint64_t{1} << (c & 63);
+        }
+        const auto weight = weights.find(issue);
+        if (weight != weights.end()) {
+            category_weights_[c] = toFixedWeight(weight->second);
+        }
+    }
+    std::vector<uint32_t> heaviest(rules_->categories().size(), 0);
+    for (uint32_t id = 0; id < rules_->patternCount(); ++id) {
+        const uint32_t c = rules_->rule(id).category;
+        if (enabled(c)) {
+            heaviest[c] = std::max(heaviest[c], patternWeight(id));
+        }
+    }
+    uint32_t all_categories = 0;
+    for (uint32_t weight : heaviest) {
+        all_categories += weight;
+    }
+    max_deduction_ = std::min(rules_->maliciousCap(), all_categories);
+}
+
+std::vector<RuleCategory> loadRuleCategories(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open rule file: " + path);
+    }
+
+    try {
+        const nlohmann::json rules = nlohmann::json::parse(file);
+        if (!rules.is_array()) {
+            throw std::runtime_error("expected a JSON array");
+        }
+
+        std::vector<RuleCategory> categories;
+        if (!rules.empty() && rules.front().is_string()) {
+            RuleCategory keywords;
+            keywords.issue = KEYWORD_ISSUE;
+            keywords.whole_word = true;
+            keywords.patterns = rules.get<std::vector<std::string>>();
+            categories.push_back(std::move(keywords));
+        } else {
+            for (const auto& entry : rules) {
+                categories.push_back(parseCategory(entry));
+            }
+        }
+        return categories;
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Invalid rule file " + path + ": " + e.what());
+    }
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include "ByteScan.h"
+#include "PatternEngine.h"
+#include "PatternMatcher.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One group of malicious-content patterns. A category reports its issue once
+// on the first matching pattern, unless report_each_pattern is set, in which
+// case every matching pattern is reported with the pattern appended to the
+// issue. Patterns match ASCII case-insensitively unless case_sensitive is set.
+// With whole_word set, a pattern that starts (ends) with a letter, digit or
+// underscore must not be preceded (followed) by one, so "hell" does not match
+// inside "hello".
+//
+// weight is what a match deducts from the safety score, and pattern_weights,
+// when not empty, gives each pattern its own (in pattern order). A category
+// deducts the weight of its heaviest matching pattern; see MaliciousScore.
+struct RuleCategory {
+    std::string issue;
+    bool report_each_pattern = false;
+    bool case_sensitive = false;
+    std::vector<std::string> patterns;
+    bool whole_word = false;
+    double weight = 0.5;
+    std::vector<double> pattern_weights{};
+};
+
+// Issue reported by keyword lists loaded with loadRuleCategories()
+extern const char* const KEYWORD_ISSUE;
+
+// Reads rule categories from a JSON file. A plain array of strings is a
+// keyword list and becomes one whole-word category reporting KEYWORD_ISSUE.
+// Otherwise the file holds an array of category objects:
+//   {"issue": "...", "patterns": ["...", ...], "whole_word": false,
+//    "case_sensitive": false, "report_each_pattern": false,
+//    "weight": 0.5, "pattern_weights": {"<pattern>": 0.2, ...}}
+// where only issue and patterns are required. Throws std::runtime_error if
+// the file cannot be read or is malformed.
+std::vector<RuleCategory> loadRuleCategories(const std::string& path);
+
+class MappedFile;
+
+// PII detectors, in the order PatternEngine::match reports them
+enum PiiPattern { PII_EMAIL, PII_PHONE, PII_SSN };
+
+// Immutable, compiled detection rules: the categories, the automata built
+// from them, the PII engine and the score weights. Shared by reference count
+// between analyzers and threads; an analysis holds the ruleset it started
+// with, so replacing an analyzer's rules never disturbs calls in flight.
+class Ruleset {
+public:
+    struct Rule {
+        uint32_t category;  // index into categories()
+        uint32_t index;     // index into the category's patterns
+    };
+
+    // Throws std::invalid_argument if a pattern is empty, a weight is outside
+    // [0, 1] or pattern_weights does not match patterns in size
+    static std::shared_ptr<const Ruleset> compile(std::vector<RuleCategory> categories);
+    // The rules this library ships with, compiled once per process
+    static std::shared_ptr<const Ruleset> builtin();
+    static std::vector<RuleCategory> builtinCategories();
+    // The built-in rules plus the categories in each rule file, compiled into
+    // one matcher (see loadRuleCategories)
+    static std::shared_ptr<const Ruleset> load(const std::vector<std::string>& rule_files);
+
+    // Compiled ruleset files carry this number; open() rejects any other
+    static constexpr uint32_t FILE_FORMAT_VERSION = 2;
+    // Writes the compiled rules in a binary format that open() maps straight
+    // back in. Throws std::runtime_error if the file cannot be written.
+    void save(const std::string& path) const;
+    // Maps a file written by save(). The automata are used in place from the
+    // mapping instead of being rebuilt; loading only checks them once.
+    // Throws std::runtime_error if the file cannot be read, has another format
+    // version or byte order, or is malformed.
+    static std::shared_ptr<const Ruleset> open(const std::string& path);
+
+    Ruleset(const Ruleset&) = delete;
+    Ruleset& operator=(const Ruleset&) = delete;
+
+    // Unique per compiled ruleset within the process
+    uint64_t version() const { return version_; }
+
+    const std::vector<RuleCategory>& categories() const { return categories_; }
+    size_t patternCount() const { return rules_.size(); }
+    const Rule& rule(uint32_t id) const { return rules_[id]; }
+    const std::string& pattern(uint32_t id) const {
+        return categories_[rules_[id].category].patterns[rules_[id].index];
+    }
+    size_t maxPatternLength() const { return matcher_.maxPatternLength(); }
+
+    // Cap on the summed deductions of malicious matches, and the deduction
+    // for any PII
+    double maliciousWeight() const { return malicious_weight_; }
+    double piiWeight() const { return pii_weight_; }
+
+    // Weights compiled to fixed point: a match of pattern id deducts
+    // patternWeight(id) / WEIGHT_SCALE
+    static constexpr uint32_t WEIGHT_SCALE = 10000;
+    uint32_t patternWeight(uint32_t id) const { return pattern_weights_[id]; }
+    uint32_t maliciousCap() const { return malicious_cap_; }
+    // The deduction if every category matched, capped: no text scores lower
+    // than 1 - maxMaliciousDeduction() / WEIGHT_SCALE - piiWeight(), or 0
+    uint32_t maxMaliciousDeduction() const { return max_deduction_; }
+
+    const PatternEngine& piiEngine() const { return *pii_engine_; }
+
+    // Calls on_match(pattern_id, begin, end) for every match in text, as
+    // PatternMatcher::scan does, with case-sensitive patterns already checked
+    template <typename Callback>
+    void scan(std::string_view text, Callback&& on_match) const;
+    // scan() in chunk_size pieces, calling keep_going(piece_size) before
+    // each. Returns false if keep_going ended the scan.
+    template <typename Callback, typename KeepGoing>
+    bool scan(std::string_view text, size_t chunk_size, Callback&& on_match, KeepGoing&& keep_going) const;
+
+    // Resumable scan over text arriving in chunks (see
+    // PatternMatcher::scanChunk). Matches are reported unconfirmed; check
+    // them with confirm() against the original bytes. A whole-word match
+    // ending at the end of the text so far needs the next byte to confirm.
+    template <typename Callback>
+    void scanChunk(std::string_view chunk, uint32_t& state, size_t stream_offset, Callback&& on_match) const {
+        matcher_.scanChunk(chunk, state, stream_offset, std::forward<Callback>(on_match));
+    }
+
+    bool wholeWord(uint32_t id) const { return categories_[rules_[id].category].whole_word; }
+
+    // The automata fold case for every pattern and ignore word boundaries;
+    // both are checked here for a match at text[begin, end). Bytes outside
+    // text count as non-word characters.
+    bool confirm(uint32_t id, std::string_view text, size_t begin, size_t end) const;
+
+private:
+    Ruleset();
+    explicit Ruleset(std::vector<RuleCategory> categories);
+    void indexRules();
+
+    uint64_t version_;
+    std::vector<RuleCategory> categories_;
+    std::vector<Rule> rules_;  // indexed by pattern id
+
+    // Every pattern in one case-insensitive automaton. Most patterns contain
+    // punctuation; text with none of those trigger bytes (found with a
+    // vectorized scan) can only match the punctuation-free patterns, so it
+    // runs the much smaller plain_matcher_ instead.
+    PatternMatcher matcher_{true};
+    ByteSet triggers_;
+    PatternMatcher plain_matcher_{true};
+    std::vector<uint32_t> plain_ids_;  // plain_matcher_ id -> pattern id
+    std::vector<uint16_t> pattern_weights_;  // indexed by pattern id, in WEIGHT_SCALE units
+    uint32_t malicious_cap_ = 0;
+    uint32_t max_deduction_ = 0;
+
+    std::shared_ptr<const MappedFile> mapping_;  // holds the tables of an opened file
+    std::shared_ptr<const PatternEngine> pii_engine_;
+    double malicious_weight_ = 1.0;
+    double pii_weight_ = 0.5;
+};
+
+// A selection of one ruleset's categories, with their own weights, that a
+// scan applies match by match: any number of profiles share the ruleset's
+// compiled matchers. Categories are named by their issue text; a name the
+// ruleset lacks selects nothing.
+class RuleProfile {
+public:
+    // categories: the ones to run, or all when empty. weights: issue ->
+    // weight for every pattern of those categories, replacing RuleCategory
+    // weight and pattern_weights. Throws std::invalid_argument if a weight is
+    // outside [0, 1].
+    RuleProfile(std::shared_ptr<const Ruleset> rules, const std::vector<std::string>& categories,
+                const std::unordered_map<std::string, double>& weights, bool detect_pii = true);
+
+    const std::shared_ptr<const Ruleset>& rules() const { return rules_; }
+    // Unique among profiles and rulesets, for cache keys
+    uint64_t version() const { return version_; }
+
+    bool enabled(uint32_t category) const { return (enabled_[category >> 6] >> (category & 63)) & 1; }
+    bool detectPII() const { return detect_pii_; }
+    uint32_t patternWeight(uint32_t id) const {
+        const uint32_t weight = category_weights_[rules_->rule(id).category];
+        return weight == RULESET_WEIGHT ? rules_->patternWeight(id) : weight;
+    }
+    // As Ruleset::maxMaliciousDeduction, over the enabled categories
+    uint32_t maxMaliciousDeduction() const { return max_deduction_; }
+
+private:
+    static constexpr uint32_t RULESET_WEIGHT = ~0u;  // no override
+
+    std::shared_ptr<const Ruleset> rules_;
+    uint64_t version_;
+    std::vector<uint64_t> enabled_;  // bit per category
+    std::vector<uint32_t> category_weights_;  // WEIGHT_SCALE units, or RULESET_WEIGHT
+    bool detect_pii_;
+    uint32_t max_deduction_ = 0;
+};
+
+// Running score deduction of the distinct malicious patterns matched so far,
+// updated in O(1) per new pattern as a scan reports them. Each category
+// counts with its heaviest matching pattern, and the total saturates at
+// Ruleset::maliciousCap(). With a profile, its weights apply.
+class MaliciousScore {
+public:
+    explicit MaliciousScore(const Ruleset& rules, const RuleProfile* profile = nullptr)
+        : rules_(rules), profile_(profile), category_max_(rules.categories().size(), 0) {}
+
+    // Adding a pattern id again changes nothing
+    void add(uint32_t id) {
+        uint32_t& heaviest = category_max_[rules_.rule(id).category];
+        const uint32_t weight = profile_ ? profile_->patternWeight(id) : rules_.patternWeight(id);
+        if (weight > heaviest) {
+            total_ = std::min(rules_.maliciousCap(), total_ + (weight - heaviest));
+            heaviest = weight;
+        }
+    }
+
+    // In Ruleset::WEIGHT_SCALE units
+    uint32_t deduction() const { return total_; }
+
+private:
+    const Ruleset& rules_;
+    const RuleProfile* profile_;
+    std::vector<uint32_t> category_max_;
+    uint32_t total_ = 0;
+};
+
+template <typename Callback>
+void Ruleset::scan(std::string_view text, Callback&& on_match) const {
+    auto confirmed = [&](uint32_t id, size_t begin, size_t end) {
+        return !confirm(id, text, begin, end) || on_match(id, begin, end);
+    };
+    if (findFirstOf(text, triggers_) < text.size()) {
+        matcher_.scan(text, confirmed);
+    } else {
+        plain_matcher_.scan(text, [&](uint32_t plain_id, size_t begin, size_t end) {
+            return confirmed(plain_ids_[plain_id], begin, end);
+        });
+    }
+}
+
+template <typename Callback, typename KeepGoing>
+bool Ruleset::scan(std::string_view text, size_t chunk_size, Callback&& on_match, KeepGoing&& keep_going) const {
+    bool stopped = false;
+    auto confirmed = [&](uint32_t id, size_t begin, size_t end) {
+        stopped = confirm(id, text, begin, end) && !on_match(id, begin, end);
+        return !stopped;
+    };
+    const bool plain = findFirstOf(text, triggers_) >= text.size();
+    uint32_t state = 0;
+    for (size_t offset = 0; offset < text.size() && !stopped; offset += chunk_size) {
+        const std::string_view chunk = text.substr(offset, chunk_size);
+        if (!keep_going(chunk.size())) {
+            return false;
+        }
+        if (plain) {
+            plain_matcher_.scanChunk(chunk, state, offset, [&](uint32_t plain_id, size_t begin, size_t end) {
+                return confirmed(plain_ids_[plain_id], begin, end);
+            });
+        } else {
+            matcher_.scanChunk(chunk, state, offset, confirmed);
+        }
+    }
+    return true;
+}
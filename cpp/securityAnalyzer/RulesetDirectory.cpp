@@ -0,0 +1,156 @@
+#include "RulesetDirectory.h"
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const CURRENT_LINK = "current";
+const std::string_view GENERATION_PREFIX = "ruleset.";
+
+[[noreturn]] void throwErrno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+std::string generationFile(uint64_t generation) {
+    return std::string(GENERATION_PREFIX) + std::to_string(generation);
+}
+
+// Generation of a file name written by generationFile, or 0
+uint64_t parseGeneration(std::string_view name) {
+    if (name.substr(0, GENERATION_PREFIX.size()) != GENERATION_PREFIX || name.size() == GENERATION_PREFIX.size()) {
+        return 0;
+    }
+    uint64_t generation = 0;
+    for (char c : name.substr(GENERATION_PREFIX.size())) {
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        generation = generation * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return generation;
+}
+
+// Exclusive flock on a file in the directory, held for the object's lifetime
+class DirectoryLock {
+public:
+    explicit DirectoryLock(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throwErrno("cannot open " + path);
+        }
+        while (::flock(fd_, LOCK_EX) != 0) {
+            if (errno != EINTR) {
+                const int error = errno;
+                ::close(fd_);
+                errno = error;
+                throwErrno("cannot lock " + path);
+            }
+        }
+    }
+    ~DirectoryLock() { ::close(fd_); }
+
+    DirectoryLock(const DirectoryLock&) = delete;
+    DirectoryLock& operator=(const DirectoryLock&) = delete;
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace
+
+uint64_t RulesetDirectory::publish(const Ruleset& ruleset) const {
+    fs::create_directories(path_);
+    DirectoryLock lock(path_ + "/.lock");
+    const uint64_t generation = currentGeneration() + 1;
+    ruleset.save(path_ + "/" + generationFile(generation));
+
+    // A relative target keeps the directory valid wherever it is mounted
+    const std::string link = path_ + "/" + CURRENT_LINK;
+    const std::string temp_link = link + ".tmp";
+    ::unlink(temp_link.c_str());
+    if (::symlink(generationFile(generation).c_str(), temp_link.c_str()) != 0) {
+        throwErrno("cannot create " + temp_link);
+    }
+    if (::rename(temp_link.c_str(), link.c_str()) != 0) {
+        const int error = errno;
+        ::unlink(temp_link.c_str());
+        errno = error;
+        throwErrno("cannot replace " + link);
+    }
+
+    // Readers that just resolved the previous generation may still be
+    // opening it, so it stays one more round
+    std::vector<fs::path> stale;
+    for (const auto& entry : fs::directory_iterator(path_)) {
+        const uint64_t old = parseGeneration(entry.path().filename().string());
+        if (old != 0 && old + 1 < generation) {
+            stale.push_back(entry.path());
+        }
+    }
+    for (const auto& file : stale) {
+        std::error_code ignored;
+        fs::remove(file, ignored);
+    }
+    return generation;
+}
+
+uint64_t RulesetDirectory::currentGeneration() const {
+    const std::string link = path_ + "/" + CURRENT_LINK;
+    char target[256];
+    const ssize_t length = ::readlink(link.c_str(), target, sizeof target);
+    if (length < 0) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        throwErrno("cannot read " + link);
+    }
+    return parseGeneration(std::string_view(target, static_cast<size_t>(length)));
+}
+
+std::shared_ptr<const Ruleset> RulesetDirectory::openCurrent(uint64_t* generation) const {
+    // Two publishes between resolving the link and opening the file delete
+    // the generation it named; resolve again and retry
+    for (int attempt = 0;; ++attempt) {
+        const uint64_t current = currentGeneration();
+        if (current == 0) {
+            throw std::runtime_error("No ruleset published in " + path_);
+        }
+        const std::string file = path_ + "/" + generationFile(current);
+        if (attempt < 3 && !fs::exists(file)) {
+            continue;
+        }
+        auto ruleset = Ruleset::open(file);
+        if (generation) {
+            *generation = current;
+        }
+        return ruleset;
+    }
+}
+
+RulesetFollower::RulesetFollower(SecurityAnalyzer& analyzer, RulesetDirectory directory)
+    : analyzer_(analyzer), directory_(std::move(directory)) {}
+
+bool RulesetFollower::poll() {
+    const uint64_t current = directory_.currentGeneration();
+    if (current == 0 || current == generation_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    if (generation_.load(std::memory_order_relaxed) == current) {
+        return false;  // another thread swapped it in meanwhile
+    }
+    uint64_t opened = 0;
+    auto ruleset = directory_.openCurrent(&opened);
+    analyzer_.setRuleset(std::move(ruleset));
+    generation_.store(opened, std::memory_order_relaxed);
+    return true;
+}
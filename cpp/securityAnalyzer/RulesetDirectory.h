@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Ruleset.h"
+#include "SecurityAnalyzer.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Compiled rulesets published by one process and mapped by many, e.g. the
+// master and the workers of a prefork server. Each publish writes the next
+// generation as its own file (Ruleset::save) and then repoints the
+// "current" symlink with an atomic rename, so a reader opens either the old
+// generation or the new one, never a partial file.
+//
+// Ruleset::open maps the automata in place, so every process on the node
+// reads them from the same page cache pages; on tmpfs (e.g. /dev/shm) those
+// pages are a shared memory segment that never touches disk. The PII regex
+// engine is still built per process.
+class RulesetDirectory {
+public:
+    explicit RulesetDirectory(std::string path) : path_(std::move(path)) {}
+
+    // Writes ruleset as the next generation and makes it current, then
+    // deletes the generations before the previous one (processes mapping
+    // them keep their pages until they let go). Publishers in several
+    // processes are serialized with a lock file. Throws std::system_error or
+    // std::runtime_error on failure.
+    uint64_t publish(const Ruleset& ruleset) const;
+
+    // 0 while nothing has been published
+    uint64_t currentGeneration() const;
+    // Maps the current generation, and stores its number in generation when
+    // given; throws std::runtime_error if nothing has been published
+    std::shared_ptr<const Ruleset> openCurrent(uint64_t* generation = nullptr) const;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+// Keeps an analyzer on the current generation of a RulesetDirectory. poll()
+// costs one readlink while the generation is unchanged, so it can run per
+// request or on a timer; when a new generation is current it is mapped and
+// swapped in with setRuleset. Safe to call from any thread. The follower
+// must not outlive the analyzer.
+class RulesetFollower {
+public:
+    RulesetFollower(SecurityAnalyzer& analyzer, RulesetDirectory directory);
+
+    // True if a new generation was swapped in
+    bool poll();
+    // Generation the analyzer is on, 0 before the first one was found
+    uint64_t generation() const { return generation_.load(std::memory_order_relaxed); }
+
+private:
+    SecurityAnalyzer& analyzer_;
+    RulesetDirectory directory_;
+    std::atomic<uint64_t> generation_{0};
+    std::mutex swap_mutex_;
+};
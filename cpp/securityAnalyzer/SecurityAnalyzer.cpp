@@ -1,278 +1,768 @@
 #include "SecurityAnalyzer.h"
+#include "Ruleset.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "ResultCache.h"
+#include "TextNormalizer.h"
+#include "EncodedRuns.h"
 #include <poppler/cpp/poppler-document.h>
 #include <poppler/cpp/poppler-page.h>
-#include <boost/regex.hpp>
-#include <nlohmann/json.hpp>
 #include <memory>
 #include <string>
 #include <iostream>
 #include <algorithm>
-
-// Regular expressions for PII detection
-const boost::regex email_pattern(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})");
-// Very strict phone pattern: require clear phone number formatting with proper separators
-const boost::regex phone_pattern(R"(\b(?:\+1[\s\-\.]?)?(?:\([2-9]\d{2}\)[\s\-\.]?|[2-9]\d{2}[\s\-\.])[2-9]\d{2}[\s\-\.]\d{4}\b|\b(?:\+\d{1,3}[\s\-\.])?(?:\d{3}[\s\-\.]\d{3}[\s\-\.]\d{4})\b)");
-const boost::regex ssn_pattern(R"(\b\d{3}-\d{2}-\d{4}\b)");
+#include <cctype>
+#include <cstring>
+#include <system_error>
+#include <tuple>
+#include <stdexcept>
+#include <utility>
 
 // Security thresholds
 const double DEFAULT_THRESHOLD = 0.8;
 const int MAX_FILE_SIZE = 10 * 1024 * 1024; // 10MB
 
+// Compile-time log level: 0 silent, 1 errors, 2 info, 3 debug. Messages
+// above it are compiled out, arguments included.
+#ifndef SECURITY_ANALYZER_LOG_LEVEL
+#define SECURITY_ANALYZER_LOG_LEVEL 1
+#endif
+
+// Streaming: PII matches up to this long are found across chunk boundaries,
+// and the PII detectors and the encoded-run decoder run once at least
+// STREAM_FLUSH_SIZE new bytes are buffered (or a whitespace-free run reaches
+// STREAM_MAX_PENDING).
+const size_t PII_WINDOW = 256;
+const size_t STREAM_FLUSH_SIZE = 4 * 1024;
+const size_t STREAM_MAX_PENDING = 64 * 1024;
+const char* const WHITESPACE = " \t\r\n\f\v";
+
+// PDFs with more pages than this are extracted in parallel stripes
+const int PDF_PAGES_PER_TASK = 8;
+// Analyses with limits check them at least this often
+const size_t BUDGET_CHECK_INTERVAL = 64 * 1024;
+
+// The running state of one call's AnalysisOptions, shared by the threads
+// working on it. Once a limit is hit every later check fails too.
+class AnalysisBudget {
+public:
+    explicit AnalysisBudget(const AnalysisOptions& limits) : limits_(limits) {}
+
+    // Charges bytes about to be scanned; false once any limit is reached
+    bool consume(size_t bytes) {
+        if (limits_.max_bytes_scanned > 0 &&
+            scanned_.fetch_add(bytes, std::memory_order_relaxed) + bytes > limits_.max_bytes_scanned) {
+            stop(ISSUE_ANALYSIS_TIMEOUT);
+        }
+        return check();
+    }
+
+    // The deadline and the cancellation token only
+    bool check() {
+        if (reason_.load(std::memory_order_relaxed) < 0) {
+            if (limits_.cancel && limits_.cancel->cancelled()) {
+                stop(ISSUE_ANALYSIS_CANCELLED);
+            } else if (std::chrono::steady_clock::now() >= limits_.deadline) {
+                stop(ISSUE_ANALYSIS_TIMEOUT);
+            }
+        }
+        return reason_.load(std::memory_order_relaxed) < 0;
+    }
+
+    // Why the analysis was cut short, if it was
+    std::optional<IssueKind> reason() const {
+        const int reason = reason_.load(std::memory_order_relaxed);
+        return reason < 0 ? std::nullopt : std::optional<IssueKind>(static_cast<IssueKind>(reason));
+    }
+
+private:
+    void stop(IssueKind reason) {
+        int none = -1;
+        reason_.compare_exchange_strong(none, reason, std::memory_order_relaxed);
+    }
+
+    const AnalysisOptions& limits_;
+    std::atomic<uint64_t> scanned_{0};
+    std::atomic<int> reason_{-1};
+};
+
+namespace {
+
+// Text kept on each side of a chunk or page boundary so that matches
+// spanning it, and the byte before them for word-boundary checks, are
+// still found
+size_t overlapWindow(const Ruleset& rules) {
+    return std::max(PII_WINDOW, rules.maxPatternLength() + 1);
+}
+
+// The first (head) or last 2 * window bytes of a page, trimmed to whitespace
+// so rescanning a page seam never starts or ends inside a word while still
+// covering any match up to window bytes long.
+std::string pageEdge(std::string_view text, size_t window, bool head) {
+    if (text.size() <= 2 * window) {
+        return std::string(text);
+    }
+    if (head) {
+        std::string_view edge = text.substr(0, 2 * window);
+        size_t space = edge.find_last_of(WHITESPACE);
+        return std::string(space != std::string_view::npos && space >= window ? edge.substr(0, space + 1) : edge);
+    }
+    std::string_view edge = text.substr(text.size() - 2 * window);
+    size_t space = edge.find_first_of(WHITESPACE);
+    return std::string(space != std::string_view::npos && space < window ? edge.substr(space) : edge);
+}
+
+enum CacheVariant : uint64_t {
+    CACHE_TEXT = 0,
+    CACHE_PDF = 1,  // PDF scan options are packed into the bits above
+};
+
+CacheKey makeCacheKey(std::string_view content, double threshold, uint64_t variant, const Ruleset& rules) {
+    CacheKey key;
+    hashContent(content, key.hash_lo, key.hash_hi);
+    key.size = content.size();
+    std::memcpy(&key.threshold_bits, &threshold, sizeof(threshold));
+    key.variant = variant;
+    key.ruleset_version = rules.version();
+    return key;
+}
+
+// Detection results for one PDF page, kept until all pages are merged
+struct PageScan {
+    Findings findings;
+    std::string head;
+    std::string tail;
+    size_t size = 0;
+};
+
+// Adds the findings of page (1-based) that are not already in merged,
+// tracked in first_hit_page by malicious pattern id
+void mergePageFindings(Findings& merged, std::vector<int>& first_hit_page, const Findings& page_findings, int page) {
+    auto mergeFlag = [page](bool& flag, int& flag_page, bool found) {
+        if (found && !flag) {
+            flag = true;
+            flag_page = page;
+        }
+    };
+    mergeFlag(merged.email, merged.email_page, page_findings.email);
+    mergeFlag(merged.phone, merged.phone_page, page_findings.phone);
+    mergeFlag(merged.ssn, merged.ssn_page, page_findings.ssn);
+    for (uint32_t id : page_findings.malicious_patterns) {
+        if (first_hit_page[id] == 0) {
+            first_hit_page[id] = page;
+        }
+    }
+}
+
+// Scans the decoded bytes of every encoded run in text, and of the runs
+// inside those, down to MAX_DECODE_DEPTH layers. origins maps offsets in text
+// back to the top-level text, one DecodedRun::origin per enclosing layer.
+// Matches on bytes that were not encoded were already reported by the scan
+// of the enclosing layer and are skipped. Returns false once on_match does.
+template <typename Callback>
+bool scanEncodedRuns(const Ruleset& rules, std::string_view text, std::vector<const std::vector<size_t>*>& origins,
+                     Callback& on_match, AnalysisBudget* budget) {
+    auto toTop = [&](size_t offset) {
+        for (auto it = origins.rbegin(); it != origins.rend(); ++it) {
+            offset = (**it)[offset];
+        }
+        return offset;
+    };
+    EncodedRunFinder finder(text);
+    DecodedRun run;
+    while (finder.next(run)) {
+        if (budget && !budget->consume(run.text.size())) {
+            return false;
+        }
+        bool stopped = false;
+        rules.scan(run.text, [&](uint32_t id, size_t begin, size_t end) {
+            const size_t from = run.origin[begin];
+            const size_t to = run.origin[end];
+            if (to - from == end - begin && text.compare(from, to - from, run.text, begin, end - begin) == 0) {
+                return true;
+            }
+            stopped = !on_match(id, toTop(from), toTop(to));
+            return !stopped;
+        });
+        if (stopped) {
+            return false;
+        }
+        if (origins.size() + 1 < static_cast<size_t>(MAX_DECODE_DEPTH)) {
+            origins.push_back(&run.origin);
+            const bool go_on = scanEncodedRuns(rules, run.text, origins, on_match, budget);
+            origins.pop_back();
+            if (!go_on) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Marks a result whose analysis hit one of its limits
+void markCutShort(AnalysisResult& result, IssueKind reason) {
+    result.is_safe = false;
+    result.issues.push_back({reason});
+    result.analysis_summary = reason == ISSUE_ANALYSIS_CANCELLED
+        ? "Analysis cancelled before it completed."
+        : "Analysis stopped at its time or size limit before it completed.";
+}
+
+// Safety score given the malicious deduction in Ruleset::WEIGHT_SCALE units
+double scoreAfter(uint32_t malicious_deduction, bool has_pii, const Ruleset& rules) {
+    double score = 1.0 - static_cast<double>(malicious_deduction) / Ruleset::WEIGHT_SCALE;
+    if (has_pii) {
+        score -= rules.piiWeight();
+    }
+    return std::max(0.0, score);
+}
+
+std::shared_ptr<const RuleProfile> resolveProfile(std::shared_ptr<const Ruleset> rules,
+                                                  const AnalysisProfile& profile) {
+    return std::make_shared<const RuleProfile>(std::move(rules), profile.categories, profile.weights,
+                                               profile.detect_pii);
+}
+
+} // namespace
+
+struct SecurityAnalyzer::ProfileTable {
+    struct Entry {
+        AnalysisProfile profile;
+        std::shared_ptr<const RuleProfile> rules;  // profile resolved against ruleset_
+    };
+    std::unordered_map<std::string, Entry> entries;
+};
+
+AnalysisOptions AnalysisOptions::withTimeout(std::chrono::milliseconds timeout) {
+    AnalysisOptions options;
+    options.deadline = std::chrono::steady_clock::now() + timeout;
+    return options;
+}
+
 // Constructor
-SecurityAnalyzer::SecurityAnalyzer(double threshold) : threshold_(threshold) {}
+SecurityAnalyzer::SecurityAnalyzer(double threshold, size_t worker_threads, size_t cache_bytes)
+    : threshold_(threshold), worker_threads_(worker_threads), metrics_(std::make_unique<Metrics>()),
+      ruleset_(Ruleset::builtin()), profiles_(std::make_shared<const ProfileTable>()) {
+    if (cache_bytes > 0) {
+        cache_ = std::make_unique<ResultCache>(cache_bytes);
+    }
+}
+
+SecurityAnalyzer::~SecurityAnalyzer() {
+    // Queued async analyses use the members below, so they finish first
+    pool_.reset();
+}
 
 void SecurityAnalyzer::setThreshold(double threshold) {
-    threshold_ = threshold;
+    threshold_.store(threshold, std::memory_order_relaxed);
 }
 
 double SecurityAnalyzer::getThreshold() const {
-    return threshold_;
+    return threshold_.load(std::memory_order_relaxed);
+}
+
+void SecurityAnalyzer::setRuleset(std::shared_ptr<const Ruleset> ruleset) {
+    if (!ruleset) {
+        throw std::invalid_argument("ruleset must not be null");
+    }
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    auto profiles = std::make_shared<ProfileTable>(*std::atomic_load(&profiles_));
+    for (auto& [id, entry] : profiles->entries) {
+        entry.rules = resolveProfile(ruleset, entry.profile);
+    }
+    std::atomic_store(&ruleset_, std::move(ruleset));
+    std::atomic_store(&profiles_, std::shared_ptr<const ProfileTable>(std::move(profiles)));
+    // Cached results hold the old ruleset (and its mapping) alive
+    if (cache_) {
+        cache_->clear();
+    }
+}
+
+void SecurityAnalyzer::setProfile(const std::string& profile_id, const AnalysisProfile& profile) {
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    const auto rules = ruleset();
+    auto checkName = [&](const std::string& issue) {
+        for (const auto& category : rules->categories()) {
+            if (category.issue == issue) {
+                return;
+            }
+        }
+        throw std::invalid_argument("profile " + profile_id + " names unknown rule category \"" + issue + "\"");
+    };
+    for (const auto& issue : profile.categories) {
+        checkName(issue);
+    }
+    for (const auto& [issue, weight] : profile.weights) {
+        checkName(issue);
+    }
+    auto resolved = resolveProfile(rules, profile);
+    auto profiles = std::make_shared<ProfileTable>(*std::atomic_load(&profiles_));
+    profiles->entries[profile_id] = {profile, std::move(resolved)};
+    std::atomic_store(&profiles_, std::shared_ptr<const ProfileTable>(std::move(profiles)));
+}
+
+bool SecurityAnalyzer::removeProfile(const std::string& profile_id) {
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    auto profiles = std::make_shared<ProfileTable>(*std::atomic_load(&profiles_));
+    if (profiles->entries.erase(profile_id) == 0) {
+        return false;
+    }
+    std::atomic_store(&profiles_, std::shared_ptr<const ProfileTable>(std::move(profiles)));
+    return true;
+}
+
+std::shared_ptr<const Ruleset> SecurityAnalyzer::ruleset() const {
+    return std::atomic_load(&ruleset_);
+}
+
+AnalysisResult SecurityAnalyzer::analyzeText(std::string_view text) const {
+    return analyzeView(text, getThreshold());
 }
 
-AnalysisResult SecurityAnalyzer::analyzeText(const std::string& text) {
+AnalysisResult SecurityAnalyzer::analyzeText(std::string_view text, const AnalysisOptions& limits) const {
+    return analyzeView(text, getThreshold(), false, &limits);
+}
+
+AnalysisResult SecurityAnalyzer::analyzeText(std::string_view text, const std::string& profile_id) const {
+    double threshold = 0;
+    const auto profile = findProfile(profile_id, threshold);
+    return analyzeView(text, threshold, false, nullptr, profile.get());
+}
+
+AnalysisResult SecurityAnalyzer::analyzeText(std::string_view text, const std::string& profile_id,
+                                             const AnalysisOptions& limits) const {
+    double threshold = 0;
+    const auto profile = findProfile(profile_id, threshold);
+    return analyzeView(text, threshold, false, &limits, profile.get());
+}
+
+std::shared_ptr<const RuleProfile> SecurityAnalyzer::findProfile(const std::string& profile_id,
+                                                                 double& threshold) const {
+    const auto profiles = std::atomic_load(&profiles_);
+    const auto it = profiles->entries.find(profile_id);
+    if (it == profiles->entries.end()) {
+        throw std::invalid_argument("unknown analysis profile: " + profile_id);
+    }
+    threshold = it->second.profile.threshold;
+    return it->second.rules;
+}
+
+AnalysisResult SecurityAnalyzer::analyzeTextSpans(std::string_view text) const {
+    return analyzeView(text, getThreshold(), true);
+}
+
+AnalysisResult SecurityAnalyzer::analyzeTextSpans(std::string_view text, const AnalysisOptions& limits) const {
+    return analyzeView(text, getThreshold(), true, &limits);
+}
+
+AnalysisResult SecurityAnalyzer::analyzeView(std::string_view text, double threshold, bool collect_spans,
+                                             const AnalysisOptions* limits, const RuleProfile* profile) const {
+    StageTimer timer(*metrics_, STAGE_ANALYZE_TEXT);
+    metrics_->add(COUNTER_TEXTS);
     AnalysisResult result;
+    if (limits && limits->unlimited()) {
+        limits = nullptr;
+    }
     
     // size guard so text files follow same 10 MB limit as PDFs
     if (text.size() > MAX_FILE_SIZE) {
         result.is_safe = false;
         result.confidence_score = 0.0;
-        result.detected_issues.push_back("File size exceeds maximum allowed size");
+        result.issues.push_back({ISSUE_FILE_TOO_LARGE});
         result.analysis_summary = "Text exceeds maximum allowed size";
         return result;
     }
     
-    // Check for PII
-    std::vector<std::string> pii_issues = detectPII(text);
-    if (!pii_issues.empty()) {
-        result.detected_issues.insert(result.detected_issues.end(), pii_issues.begin(), pii_issues.end());
+    // One snapshot of the rules for the whole call
+    const auto rules = profile ? profile->rules() : ruleset();
+    // Spans are per-request detail and would bloat cached entries
+    bool cacheable = cache_ && !collect_spans;
+    CacheKey key;
+    uint64_t cache_generation = 0;
+    if (cacheable) {
+        // A setRuleset after this check clears the cache and so drops the
+        // insert; one before it leaves these rules stale, not worth caching
+        cache_generation = cache_->generation();
+        cacheable = rules == ruleset();
+    }
+    if (cacheable) {
+        key = makeCacheKey(text, threshold, CACHE_TEXT, *rules);
+        if (profile) {
+            key.ruleset_version = profile->version();
+        }
+        if (cache_->lookup(key, result)) {
+            return result;
+        }
     }
     
-    // Check for malicious content
-    std::vector<std::string> malicious_issues = detectMaliciousContent(text);
-    if (!malicious_issues.empty()) {
-        result.detected_issues.insert(result.detected_issues.end(), malicious_issues.begin(), malicious_issues.end());
+    // Run every detector once; issues and score are both derived from the findings
+    std::optional<AnalysisBudget> budget;
+    if (limits) {
+        budget.emplace(*limits);
     }
+    Findings findings = scan(text, *rules, collect_spans, budget ? &*budget : nullptr, profile);
+    recordFindings(findings, *rules);
+    result.issues = describeFindings(findings, *rules);
+    result.spans = std::move(findings.spans);
+    result.ruleset = rules;
     
     // Calculate safety score
-    result.confidence_score = calculateSafetyScore(text);
-    result.is_safe = result.confidence_score >= threshold_;
+    result.confidence_score = calculateSafetyScore(findings, *rules, profile);
+    result.is_safe = result.confidence_score >= threshold;
     
     // Generate analysis summary
     result.analysis_summary = std::string("Text analysis completed. ")
         + (result.is_safe ? "No security issues detected." : "Potential security issues identified.");
     
+    if (budget && budget->reason()) {
+        metrics_->add(COUNTER_CUT_SHORT);
+        markCutShort(result, *budget->reason());
+        return result;
+    }
+    if (cacheable) {
+        cache_->insert(key, result, cache_generation);
+    }
     return result;
 }
 
-std::vector<std::string> SecurityAnalyzer::detectMaliciousContent(const std::string& text) {
-    std::vector<std::string> issues;
-    
-    // Convert to lowercase for case-insensitive matching
-    std::string text_lower = text;
-    std::transform(text_lower.begin(), text_lower.end(), text_lower.begin(), ::tolower);
-    
-    // SQL Injection patterns (comprehensive)
-    std::vector<std::string> sql_patterns = {
-        "' or '", "' or 1=1", "' or 1=1--", "' or '1'='1", "' or \"1\"=\"1",
-        "' union select", "union all select", "' having '", "' group by '",
-        "' order by ", "' drop table", "'; drop table", "' delete from", "' insert into",
-        "' update ", "' alter table", "' create table", "' truncate ",
-        "'; exec", "'; execute", "xp_cmdshell", "sp_executesql",
-        "benchmark(", "sleep(", "waitfor delay", "pg_sleep(",
-        "extractvalue(", "updatexml(", "load_file(", "into outfile",
-        "information_schema", "mysql.user", "sysobjects", "syscolumns"
-    };
-    
-    for (const auto& pattern : sql_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential SQL injection attempt detected");
-            break;
-        }
+Findings SecurityAnalyzer::scan(std::string_view text, const Ruleset& rules, bool collect_spans,
+                                AnalysisBudget* budget, const RuleProfile* profile) const {
+    Findings findings;
+    metrics_->add(COUNTER_BYTES_SCANNED, text.size());
+    if (!profile || profile->detectPII()) {
+        detectPII(text, rules, findings, collect_spans, budget);
     }
-    
-    // XSS/JavaScript injection patterns (comprehensive)
-    std::vector<std::string> xss_patterns = {
-        "<script", "</script>", "javascript:", "vbscript:", "onload=", "onerror=",
-        "onclick=", "onmouseover=", "onfocus=", "onblur=", "onchange=",
-        "onsubmit=", "onreset=", "onkeydown=", "onkeyup=", "onkeypress=",
-        "document.cookie", "document.write", "window.location", "eval(",
-        "settimeout(", "setinterval(", "innerhtml=", "outerhtml=",
-        "document.getelementbyid", "alert(", "confirm(", "prompt(",
-        "fromcharcode(", "unescape(", "string.fromcharcode"
-    };
-    
-    for (const auto& pattern : xss_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential XSS attack detected");
-            break;
-        }
+    detectMaliciousContent(text, rules, findings, std::nullopt, collect_spans, budget, profile);
+    if (collect_spans) {
+        std::sort(findings.spans.begin(), findings.spans.end(), [](const Span& a, const Span& b) {
+            return a.begin != b.begin ? a.begin < b.begin : a.end < b.end;
+        });
     }
-    
-    // Command injection patterns (comprehensive)
-    std::vector<std::string> cmd_patterns = {
-        "; rm -rf", "; del ", "& echo", "| nc ", "| netcat", "; wget",
-        "; curl", "; cat /etc/passwd", "; cat /etc/shadow", "$(", "`",
-        "; ls -la", "; dir", "; whoami", "; id", "; uname", "; ps aux",
-        "; netstat", "; ifconfig", "; ping", "; nslookup", "; dig",
-        "; chmod +x", "; ./", "&&", "||", "; sh", "; bash", "; cmd",
-        "; powershell", "& type", "& copy", "& move", "& ren"
-    };
-    
-    for (const auto& pattern : cmd_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential command injection attempt detected");
-            break;
+    return findings;
+}
+
+void SecurityAnalyzer::detectMaliciousContent(std::string_view text, const Ruleset& rules, Findings& findings,
+                                              std::optional<double> stop_below, bool collect_spans,
+                                              AnalysisBudget* budget, const RuleProfile* profile) const {
+    StageTimer timer(*metrics_, STAGE_DETECT_MALICIOUS);
+    // Single pass for all categories
+    std::vector<bool> pattern_hit(rules.patternCount(), false);
+    MaliciousScore score(rules, profile);
+    bool stopped = false;
+    auto onMatch = [&](uint32_t id, size_t begin, size_t end) {
+        if (profile && !profile->enabled(rules.rule(id).category)) {
+            return true;
         }
-    }
-    
-    // NoSQL injection patterns
-    std::vector<std::string> nosql_patterns = {
-        "$where", "$ne", "$in", "$nin", "$regex", "$exists", "$elemMatch",
-        "$gt", "$gte", "$lt", "$lte", "$or", "$and", "$not", "$nor",
-        "this.password", "this.username", "db.eval", "mapreduce",
-        "return true", "return false", "; return ", "var x=", "var y="
-    };
-    
-    for (const auto& pattern : nosql_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential NoSQL injection attempt detected");
-            break;
+        if (collect_spans) {
+            findings.spans.push_back({ISSUE_PATTERN, id, begin, end, 0});
         }
-    }
-    
-    // LDAP injection patterns
-    std::vector<std::string> ldap_patterns = {
-        ")(cn=*", ")(uid=*", ")(mail=*", ")(&", ")(|", "*)(uid=*",
-        "*)(cn=*", "admin*", "*admin", ")(objectclass=*"
+        if (pattern_hit[id]) {
+            return true;
+        }
+        pattern_hit[id] = true;
+        if (!stop_below) {
+            return true;
+        }
+        // Early exit: the score only drops as hits accumulate
+        findings.malicious_patterns.push_back(id);
+        score.add(id);
+        stopped = scoreAfter(score.deduction(), findings.hasPII(), rules) < *stop_below;
+        return !stopped;
     };
+    bool completed = true;
+    if (budget) {
+        completed = rules.scan(text, BUDGET_CHECK_INTERVAL, onMatch,
+                               [&](size_t bytes) { return budget->consume(bytes); });
+    } else {
+        rules.scan(text, onMatch);
+    }
+    // Then the same automaton over the decoded form of encoded runs
+    if (!stopped && completed) {
+        std::vector<const std::vector<size_t>*> origins;
+        scanEncodedRuns(rules, text, origins, onMatch, budget);
+    }
     
-    for (const auto& pattern : ldap_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential LDAP injection attempt detected");
-            break;
+    findings.malicious_patterns.clear();
+    for (uint32_t id = 0; id < pattern_hit.size(); ++id) {
+        if (pattern_hit[id]) {
+            findings.malicious_patterns.push_back(id);
         }
     }
-    
-    // Path traversal patterns
-    std::vector<std::string> path_patterns = {
-        "../", "..\\", "%2e%2e%2f", "%2e%2e%5c", "....//", "....\\\\",
-        "/etc/passwd", "/etc/shadow", "/etc/hosts", "c:\\windows\\system32",
-        "boot.ini", "web.config", ".env", ".htaccess", "/proc/self/environ"
+}
+
+std::vector<Issue> SecurityAnalyzer::describeFindings(const Findings& findings, const Ruleset& rules) const {
+    std::vector<Issue> issues;
+    // Page of an issue covering several findings: the earliest one that has a page
+    auto notePage = [&](size_t index, int page) {
+        if (page != 0 && (issues[index].page == 0 || page < issues[index].page)) {
+            issues[index].page = page;
+        }
     };
     
-    for (const auto& pattern : path_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential path traversal attempt detected");
-            break;
+    // PII first, with a generic flag ahead of the specific ones for convenience
+    if (findings.hasPII()) {
+        issues.push_back({ISSUE_PII});
+        const size_t generic = issues.size() - 1;
+        if (findings.email) {
+            issues.push_back({ISSUE_EMAIL, 0, findings.email_page});
+            notePage(generic, findings.email_page);
+        }
+        if (findings.phone) {
+            issues.push_back({ISSUE_PHONE, 0, findings.phone_page});
+            notePage(generic, findings.phone_page);
+        }
+        if (findings.ssn) {
+            issues.push_back({ISSUE_SSN, 0, findings.ssn_page});
+            notePage(generic, findings.ssn_page);
         }
     }
     
-    // XML/XXE injection patterns
-    std::vector<std::string> xml_patterns = {
-        "<!entity", "<!doctype", "system \"file://", "system \"http://",
-        "system \"ftp://", "%xxe;", "&xxe;", "xml version=", "<?xml"
-    };
-    
-    for (const auto& pattern : xml_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential XML/XXE injection attempt detected");
-            break;
+    // Malicious patterns are stored in table order, so issues come out grouped by category
+    const auto& categories = rules.categories();
+    std::vector<size_t> category_issue(categories.size(), SIZE_MAX);
+    for (size_t k = 0; k < findings.malicious_patterns.size(); ++k) {
+        const uint32_t id = findings.malicious_patterns[k];
+        const int page = k < findings.malicious_pages.size() ? findings.malicious_pages[k] : 0;
+        const Ruleset::Rule& rule = rules.rule(id);
+        if (categories[rule.category].report_each_pattern) {
+            issues.push_back({ISSUE_PATTERN, id, page});
+        } else if (category_issue[rule.category] == SIZE_MAX) {
+            issues.push_back({ISSUE_PATTERN, id, page});
+            category_issue[rule.category] = issues.size() - 1;
+        } else {
+            notePage(category_issue[rule.category], page);
         }
     }
     
-    // Template injection patterns
-    std::vector<std::string> template_patterns = {
-        "{{", "}}", "${", "#{", "<%", "%>", "@{", "[[", "]]",
-        "__import__", "getattr(", "setattr(", "__builtins__",
-        "exec(", "eval(", "compile(", "__globals__"
-    };
-    
-    for (const auto& pattern : template_patterns) {
-        if (text.find(pattern) != std::string::npos) {
-            issues.push_back("Potential template injection attempt detected");
-            break;
+    return issues;
+}
+
+std::string redact(std::string_view text, const std::vector<Span>& spans, char mask) {
+    std::string masked(text);
+    for (const Span& span : spans) {
+        const size_t end = std::min(span.end, masked.size());
+        if (span.begin < end) {
+            std::fill(masked.begin() + span.begin, masked.begin() + end, mask);
         }
     }
+    return masked;
+}
+
+std::string AnalysisResult::describeIssue(const Issue& issue) const {
+    switch (issue.kind) {
+    case ISSUE_PII:
+        return "PII detected";
+    case ISSUE_EMAIL:
+        return "Email address detected";
+    case ISSUE_PHONE:
+        return "Phone number detected";
+    case ISSUE_SSN:
+        return "Social Security Number detected";
+    case ISSUE_PATTERN: {
+        const Ruleset::Rule& rule = ruleset->rule(issue.pattern_id);
+        const RuleCategory& category = ruleset->categories()[rule.category];
+        return category.report_each_pattern ? category.issue + category.patterns[rule.index] : category.issue;
+    }
+    case ISSUE_FILE_TOO_LARGE:
+        return "File size exceeds maximum allowed size";
+    case ISSUE_INVALID_PDF:
+        return "invalid_or_corrupted_pdf";
+    case ISSUE_PDF_JAVASCRIPT:
+        return "PDF contains JavaScript";
+    case ISSUE_PDF_LAUNCH:
+        return "PDF contains a Launch action";
+    case ISSUE_PDF_EMBEDDED_FILES:
+        return "PDF contains embedded files";
+    case ISSUE_PDF_BUDGET_EXHAUSTED:
+        return "PDF analysis budget exhausted before the last page";
+    case ISSUE_ANALYSIS_TIMEOUT:
+        return "analysis_timeout";
+    case ISSUE_ANALYSIS_CANCELLED:
+        return "analysis_cancelled";
+    case ISSUE_ERROR:
+        return error;
+    }
+    return std::string();
+}
+
+std::vector<std::string> AnalysisResult::detectedIssues() const {
+    std::vector<std::string> texts;
+    texts.reserve(issues.size());
+    for (const auto& issue : issues) {
+        texts.push_back(describeIssue(issue));
+    }
+    return texts;
+}
+
+std::vector<int> AnalysisResult::issuePages() const {
+    std::vector<int> pages;
+    pages.reserve(issues.size());
+    for (const auto& issue : issues) {
+        pages.push_back(issue.page);
+    }
+    return pages;
+}
+
+AnalysisResult SecurityAnalyzer::analyzePDF(ByteView pdf_data) const {
+    PDFScanOptions full;
+    full.stop_when_decided = false;
+    return analyzePDF(pdf_data, full);
+}
+
+AnalysisResult SecurityAnalyzer::analyzePDF(ByteView pdf_data, const PDFScanOptions& options) const {
+    return analyzePDFWithin(pdf_data, options, getThreshold(), nullptr);
+}
+
+AnalysisResult SecurityAnalyzer::analyzePDF(ByteView pdf_data, const PDFScanOptions& options,
+                                            const AnalysisOptions& limits) const {
+    return analyzePDFWithin(pdf_data, options, getThreshold(), &limits);
+}
+
+AnalysisResult SecurityAnalyzer::analyzePDF(ByteView pdf_data, const std::string& profile_id) const {
+    double threshold = 0;
+    const auto profile = findProfile(profile_id, threshold);
+    PDFScanOptions full;
+    full.stop_when_decided = false;
+    return analyzePDFWithin(pdf_data, full, threshold, nullptr, profile.get());
+}
+
+AnalysisResult SecurityAnalyzer::analyzePDFWithin(ByteView pdf_data, const PDFScanOptions& options, double threshold,
+                                                  const AnalysisOptions* limits, const RuleProfile* profile) const {
+    StageTimer timer(*metrics_, STAGE_ANALYZE_PDF);
+    metrics_->add(COUNTER_PDFS);
+    if (limits && limits->unlimited()) {
+        limits = nullptr;
+    }
     
-    // Code execution function patterns (comprehensive)
-    std::vector<std::string> exec_patterns = {
-        // PHP functions
-        "system(", "exec(", "shell_exec(", "passthru(", "popen(",
-        "proc_open(", "eval(", "base64_decode", "file_get_contents(",
-        "fopen(", "fwrite(", "unlink(", "chmod(", "chown(", "mkdir(",
-        "rmdir(", "symlink(", "readfile(", "include(", "require(",
-        "preg_replace(", "create_function(", "call_user_func(",
-        
-        // Python functions
-        "__import__(", "getattr(", "setattr(", "hasattr(", "delattr(",
-        "globals(", "locals(", "vars(", "dir(", "compile(", "execfile(",
-        "input(", "raw_input(", "open(", "file(", "__builtins__",
-        
-        // JavaScript functions
-        "function(", "new function", "constructor(", "apply(", "call(",
-        "bind(", "with(", "delete ", "void(", "typeof ",
-        
-        // System commands
-        "cmd.exe", "/bin/sh", "/bin/bash", "powershell.exe", "sh.exe",
-        "bash.exe", "python.exe", "perl.exe", "ruby.exe", "java.exe",
-        
-        // Network functions
-        "curl(", "wget(", "fetch(", "xmlhttprequest", "ajax(",
-        "socket(", "connect(", "bind(", "listen(", "accept("
-    };
-    
-    for (const auto& pattern : exec_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Potential code execution attempt detected: " + pattern);
-        }
+    // Check file size
+    if (pdf_data.size > MAX_FILE_SIZE) {
+        AnalysisResult result;
+        result.is_safe = false;
+        result.issues.push_back({ISSUE_FILE_TOO_LARGE});
+        return result;
     }
     
-    // Additional suspicious patterns
-    std::vector<std::string> suspicious_patterns = {
-        "base64", "hex2bin", "bin2hex", "rot13", "str_rot13",
-        "gzinflate(", "gzuncompress(", "bzdecompress(",
-        "mcrypt_decrypt(", "openssl_decrypt(", "password_verify(",
-        "crypt(", "md5(", "sha1(", "hash(", "hash_hmac("
-    };
+    const auto rules = profile ? profile->rules() : ruleset();
     
-    for (const auto& pattern : suspicious_patterns) {
-        if (text_lower.find(pattern) != std::string::npos) {
-            issues.push_back("Suspicious function detected: " + pattern);
+    // A time budget makes the result depend on machine load, so it is never cached
+    bool cacheable = cache_ && options.time_budget.count() <= 0 && !options.collect_spans;
+    CacheKey key;
+    uint64_t cache_generation = 0;
+    AnalysisResult result;
+    if (cacheable) {
+        // As in analyzeView: results of rules swapped out meanwhile are not stored
+        cache_generation = cache_->generation();
+        cacheable = rules == ruleset();
+    }
+    if (cacheable) {
+        const uint64_t variant = CACHE_PDF | (options.stop_when_decided ? 2 : 0) |
+                                 static_cast<uint64_t>(std::max(options.max_pages, 0)) << 2;
+        key = makeCacheKey(std::string_view(reinterpret_cast<const char*>(pdf_data.data), pdf_data.size),
+                           threshold, variant, *rules);
+        if (profile) {
+            key.ruleset_version = profile->version();
+        }
+        if (cache_->lookup(key, result)) {
+            return result;
         }
     }
     
-    return issues;
+    std::optional<AnalysisBudget> budget;
+    if (limits) {
+        budget.emplace(*limits);
+    }
+    bool complete = true;
+    result = runPDFAnalysis(pdf_data, options, threshold, *rules, complete, budget ? &*budget : nullptr, profile);
+    result.ruleset = rules;
+    if (budget && budget->reason()) {
+        metrics_->add(COUNTER_CUT_SHORT);
+        markCutShort(result, *budget->reason());
+        return result;
+    }
+    if (cacheable && complete) {
+        cache_->insert(key, result, cache_generation);
+    }
+    return result;
 }
 
-AnalysisResult SecurityAnalyzer::analyzePDF(const std::vector<uint8_t>& pdf_data) {
+AnalysisResult SecurityAnalyzer::runPDFAnalysis(ByteView pdf_data, const PDFScanOptions& options,
+                                                double threshold, const Ruleset& rules, bool& complete,
+                                                AnalysisBudget* budget, const RuleProfile* profile) const {
     AnalysisResult result;
     
-    // Check file size
-    if (pdf_data.size() > MAX_FILE_SIZE) {
+    // Raw-byte structural pre-scan: hostile or malformed files are rejected
+    // here, in microseconds, without paying for a Poppler parse
+    {
+        StageTimer timer(*metrics_, STAGE_PDF_STRUCTURE);
+        result.pdf_structure = scanPDFStructure(
+            std::string_view(reinterpret_cast<const char*>(pdf_data.data), pdf_data.size));
+    }
+    const PDFStructure& structure = result.pdf_structure;
+    if (structure.object_count == 0) {
+        result.is_safe = false;
+        result.issues.push_back({ISSUE_INVALID_PDF});
+        return result;
+    }
+    if (structure.javascript || structure.launch) {
         result.is_safe = false;
-        result.detected_issues.push_back("File size exceeds maximum allowed size");
+        result.confidence_score = 0.0;
+        if (structure.javascript) {
+            result.issues.push_back({ISSUE_PDF_JAVASCRIPT});
+        }
+        if (structure.launch) {
+            result.issues.push_back({ISSUE_PDF_LAUNCH});
+        }
+        result.analysis_summary = "PDF analysis completed. Active content found in document structure.";
+        return result;
+    }
+    if (budget && !budget->check()) {
         return result;
     }
     
     try {
         // Load PDF
-        auto doc = loadPDF(pdf_data);
+        std::unique_ptr<poppler::document> doc;
+        {
+            StageTimer timer(*metrics_, STAGE_LOAD_PDF);
+            doc = loadPDF(pdf_data);
+        }
 
         if (!doc) {
             result.is_safe = false;
-            result.detected_issues.push_back("invalid_or_corrupted_pdf");
+            result.issues.push_back({ISSUE_INVALID_PDF});
+            return result;
+        }
+        if (budget && !budget->check()) {
             return result;
         }
 
-        // Extract text
-        std::string text_content = extractTextFromPDF(doc);
+        // Extract and scan page by page
+        PDFPass pass = scanPDFPages(pdf_data, *doc, threshold, rules, options, budget, profile);
+        result.pages_analyzed = pass.pages_analyzed;
+        Findings& findings = pass.findings;
+        recordFindings(findings, rules);
         
-        // Debug: Log extracted text content (first 200 chars)
-        std::cout << "DEBUG: Extracted PDF text (first 200 chars): " 
-                  << text_content.substr(0, std::min(200UL, text_content.length())) << std::endl;
+#if SECURITY_ANALYZER_LOG_LEVEL >= 3
+        std::clog << "DEBUG: Extracted PDF text (first 200 chars): " << pass.preview << '\n';
+#endif
         
-        // Analyze extracted text using the same method as text files
-        result = analyzeText(text_content);
+        // Same size rule and scoring as text files
+        if (pass.text_size > MAX_FILE_SIZE) {
+            result.is_safe = false;
+            result.confidence_score = 0.0;
+            result.issues.push_back({ISSUE_FILE_TOO_LARGE});
+        } else {
+            result.issues = describeFindings(findings, rules);
+            result.spans = std::move(findings.spans);
+            result.confidence_score = calculateSafetyScore(findings, rules, profile);
+            result.is_safe = result.confidence_score >= threshold;
+        }
+        
+        // Pages left unscanned may hide anything, so a cut-short pass fails closed
+        if (pass.budget_exhausted) {
+            result.is_safe = false;
+            result.issues.push_back({ISSUE_PDF_BUDGET_EXHAUSTED});
+        }
         
         // Update analysis summary to indicate PDF processing
         result.analysis_summary = std::string("PDF analysis completed. ") + 
@@ -282,84 +772,545 @@ AnalysisResult SecurityAnalyzer::analyzePDF(const std::vector<uint8_t>& pdf_data
         // Add PDF-specific analysis
         if (result.is_safe) {
             // Check for embedded scripts
-            if (doc->has_embedded_files()) {
-                result.detected_issues.push_back("PDF contains embedded files");
+            if (structure.embedded_file || doc->has_embedded_files()) {
+                result.issues.push_back({ISSUE_PDF_EMBEDDED_FILES});
                 result.confidence_score *= 0.8;  // Reduce confidence
             }
         }
         
-        result.is_safe = result.confidence_score >= threshold_;
+        result.is_safe = !pass.budget_exhausted && result.confidence_score >= threshold;
         
     } catch (const std::exception& e) {
+        complete = false;
         result.is_safe = false;
-        result.detected_issues.push_back("Error processing PDF: " + std::string(e.what()));
+        result.issues.push_back({ISSUE_ERROR});
+        result.error = "Error processing PDF: " + std::string(e.what());
     }
     
     return result;
 }
 
-std::vector<std::string> SecurityAnalyzer::detectPII(const std::string& text) {
-    std::vector<std::string> issues;
-    
-    boost::smatch email_matches;
-    if (boost::regex_search(text, email_matches, email_pattern)) {
-        issues.push_back("Email address detected");
+void SecurityAnalyzer::detectPII(std::string_view text, const Ruleset& rules, Findings& findings,
+                                 bool collect_spans, AnalysisBudget* budget) const {
+    StageTimer timer(*metrics_, STAGE_DETECT_PII);
+    auto record = [&](const RegexMatch& match, size_t offset) {
+        static const IssueKind kinds[] = {ISSUE_EMAIL, ISSUE_PHONE, ISSUE_SSN};
+        bool* flags[] = {&findings.email, &findings.phone, &findings.ssn};
+        *flags[match.pattern] = true;
+        if (collect_spans) {
+            findings.spans.push_back({kinds[match.pattern], 0, offset + match.begin, offset + match.end, 0});
+        }
+    };
+    if (budget) {
+        // In pieces, so the limits are checked between them. Each piece is
+        // matched with PII_WINDOW bytes of context on both sides, so word
+        // boundaries at its edges are judged on the real neighbours, and
+        // keeps the matches that start inside it.
+        for (size_t start = 0; start < text.size(); start += BUDGET_CHECK_INTERVAL) {
+            if (!budget->check()) {
+                return;
+            }
+            const size_t piece_end = std::min(text.size(), start + BUDGET_CHECK_INTERVAL);
+            const size_t from = start > PII_WINDOW ? start - PII_WINDOW : 0;
+            const std::string_view piece = text.substr(from, piece_end + PII_WINDOW - from);
+            for (const RegexMatch& match : rules.piiEngine().findAll(piece)) {
+                if (from + match.begin >= start && from + match.begin < piece_end) {
+                    record(match, from);
+                }
+            }
+        }
+        return;
     }
-    
-    boost::smatch phone_matches;
-    if (boost::regex_search(text, phone_matches, phone_pattern)) {
-        issues.push_back("Phone number detected");
+    if (collect_spans) {
+        for (const RegexMatch& match : rules.piiEngine().findAll(text)) {
+            record(match, 0);
+        }
+        return;
     }
-    
-    boost::smatch ssn_matches;
-    if (boost::regex_search(text, ssn_matches, ssn_pattern)) {
-        issues.push_back("Social Security Number detected");
+    std::vector<bool> matched = rules.piiEngine().match(text);
+    findings.email = matched[PII_EMAIL];
+    findings.phone = matched[PII_PHONE];
+    findings.ssn = matched[PII_SSN];
+}
+
+double SecurityAnalyzer::calculateSafetyScore(const Findings& findings, const Ruleset& rules,
+                                              const RuleProfile* profile) const {
+    MaliciousScore score(rules, profile);
+    for (uint32_t id : findings.malicious_patterns) {
+        score.add(id);
     }
-    
-    // If any PII issues were found, add a generic flag as well for convenience
-    if (!issues.empty()) {
-        issues.insert(issues.begin(), "PII detected");
+    return scoreAfter(score.deduction(), findings.hasPII(), rules);
+}
+
+bool SecurityAnalyzer::isContentSafe(std::string_view content, double threshold) const {
+    if (content.size() > MAX_FILE_SIZE) {
+        return false;
     }
     
-    return issues;
+    // Verdict only: no issue strings, and detection stops as soon as the
+    // score is below the stricter of the two thresholds. The automaton runs
+    // first since it is the cheaper detector.
+    const double required = std::max(getThreshold(), threshold);
+    const auto rules = ruleset();
+    Findings findings;
+    detectMaliciousContent(content, *rules, findings, required);
+    if (calculateSafetyScore(findings, *rules) < required) {
+        return false;
+    }
+    detectPII(content, *rules, findings);
+    return calculateSafetyScore(findings, *rules) >= required;
 }
 
-double SecurityAnalyzer::calculateSafetyScore(const std::string& text) {
-    double score = 1.0;
+AnalysisResult SecurityAnalyzer::analyzeFile(const std::string& path) const {
+    return analyzeFileWithin(path, getThreshold(), nullptr);
+}
 
-    if (!detectMaliciousContent(text).empty()) {
-        score -= 0.5;
+AnalysisResult SecurityAnalyzer::analyzeFile(const std::string& path, const AnalysisOptions& limits) const {
+    return analyzeFileWithin(path, getThreshold(), &limits);
+}
+
+AnalysisResult SecurityAnalyzer::analyzeFile(const std::string& path, const std::string& profile_id) const {
+    double threshold = 0;
+    const auto profile = findProfile(profile_id, threshold);
+    return analyzeFileWithin(path, threshold, nullptr, profile.get());
+}
+
+AnalysisResult SecurityAnalyzer::analyzeFile(const std::string& path, const std::string& profile_id,
+                                             const AnalysisOptions& limits) const {
+    double threshold = 0;
+    const auto profile = findProfile(profile_id, threshold);
+    return analyzeFileWithin(path, threshold, &limits, profile.get());
+}
+
+AnalysisResult SecurityAnalyzer::analyzeFileWithin(const std::string& path, double threshold,
+                                                   const AnalysisOptions* limits, const RuleProfile* profile) const {
+    try {
+        MappedFile file(path);
+        std::string_view content = file.text();
+        if (content.substr(0, 4) == "%PDF") {
+            PDFScanOptions full;
+            full.stop_when_decided = false;
+            return analyzePDFWithin(ByteView(file.data(), file.size()), full, threshold, limits, profile);
+        }
+        return analyzeView(content, threshold, false, limits, profile);
+    } catch (const std::system_error& e) {
+        AnalysisResult result;
+        result.is_safe = false;
+        result.issues.push_back({ISSUE_ERROR});
+        result.error = "Error reading file: " + std::string(e.what());
+        return result;
     }
+}
+
+CacheStats SecurityAnalyzer::cacheStats() const {
+    return cache_ ? cache_->stats() : CacheStats();
+}
 
-    if (!detectPII(text).empty()) {
-        score -= 0.5;
+void SecurityAnalyzer::clearCache() {
+    if (cache_) {
+        cache_->clear();
     }
+}
 
-    return score;
+MetricsSnapshot SecurityAnalyzer::getMetrics() const {
+    std::vector<std::string> names;
+    for (const RuleCategory& category : ruleset()->categories()) {
+        names.push_back(category.issue);
+    }
+    return metrics_->snapshot(names);
 }
 
-bool SecurityAnalyzer::isContentSafe(const std::string& content, double threshold) {
-    AnalysisResult result = analyzeText(content);
-    return result.is_safe && result.confidence_score >= threshold;
+void SecurityAnalyzer::recordFindings(const Findings& findings, const Ruleset& rules) const {
+    if (findings.email) {
+        metrics_->add(COUNTER_EMAIL);
+    }
+    if (findings.phone) {
+        metrics_->add(COUNTER_PHONE);
+    }
+    if (findings.ssn) {
+        metrics_->add(COUNTER_SSN);
+    }
+    for (uint32_t id : findings.malicious_patterns) {
+        metrics_->addCategoryMatches(rules.rule(id).category, 1);
+    }
+}
+
+ThreadPool& SecurityAnalyzer::workerPool() const {
+    std::call_once(pool_once_, [this]() {
+        pool_ = std::make_unique<ThreadPool>(worker_threads_);
+    });
+    return *pool_;
 }
 
-std::unique_ptr<poppler::document> SecurityAnalyzer::loadPDF(const std::vector<uint8_t>& pdf_data) {
+std::vector<AnalysisResult> SecurityAnalyzer::analyzeBatch(const std::vector<std::string_view>& texts) const {
+    std::vector<AnalysisResult> results(texts.size());
+    const double threshold = getThreshold();
+    workerPool().parallelFor(texts.size(), [&](size_t i) {
+        results[i] = analyzeView(texts[i], threshold);
+    });
+    return results;
+}
+
+std::vector<AnalysisResult> SecurityAnalyzer::analyzePDFBatch(const std::vector<std::vector<uint8_t>>& documents) const {
+    return analyzePDFBatch(std::vector<ByteView>(documents.begin(), documents.end()));
+}
+
+std::vector<AnalysisResult> SecurityAnalyzer::analyzePDFBatch(const std::vector<ByteView>& documents) const {
+    std::vector<AnalysisResult> results(documents.size());
+    workerPool().parallelFor(documents.size(), [&](size_t i) {
+        results[i] = analyzePDF(documents[i]);
+    });
+    return results;
+}
+
+std::future<AnalysisResult> SecurityAnalyzer::analyzeAsync(std::string_view text,
+                                                           const AnalysisOptions& limits) const {
+    return workerPool().submit([this, text, limits]() { return analyzeText(text, limits); });
+}
+
+std::future<AnalysisResult> SecurityAnalyzer::analyzePDFAsync(ByteView pdf_data,
+                                                              const AnalysisOptions& limits) const {
+    return workerPool().submit([this, pdf_data, limits]() {
+        PDFScanOptions full;
+        full.stop_when_decided = false;
+        return analyzePDF(pdf_data, full, limits);
+    });
+}
+
+void SecurityAnalyzer::analyzeAsync(std::string_view text, const AnalysisOptions& limits,
+                                    AnalysisCallback on_done) const {
+    workerPool().submit([this, text, limits, on_done = std::move(on_done)]() {
+        AnalysisResult result;
+        try {
+            result = analyzeText(text, limits);
+        } catch (const std::exception& e) {
+            result = AnalysisResult();
+            result.is_safe = false;
+            result.issues.push_back({ISSUE_ERROR});
+            result.error = "Error analyzing text: " + std::string(e.what());
+        }
+        on_done(std::move(result));
+    });
+}
+
+void SecurityAnalyzer::analyzePDFAsync(ByteView pdf_data, const AnalysisOptions& limits,
+                                       AnalysisCallback on_done) const {
+    workerPool().submit([this, pdf_data, limits, on_done = std::move(on_done)]() {
+        PDFScanOptions full;
+        full.stop_when_decided = false;
+        AnalysisResult result;
+        try {
+            result = analyzePDF(pdf_data, full, limits);
+        } catch (const std::exception& e) {
+            result = AnalysisResult();
+            result.is_safe = false;
+            result.issues.push_back({ISSUE_ERROR});
+            result.error = "Error processing PDF: " + std::string(e.what());
+        }
+        on_done(std::move(result));
+    });
+}
+
+std::unique_ptr<poppler::document> SecurityAnalyzer::loadPDF(ByteView pdf_data) const {
     return std::unique_ptr<poppler::document>(poppler::document::load_from_raw_data(
-        reinterpret_cast<const char*>(pdf_data.data()), pdf_data.size()
+        reinterpret_cast<const char*>(pdf_data.data), static_cast<int>(pdf_data.size)
     ));
 }
 
-std::string SecurityAnalyzer::extractTextFromPDF(const std::unique_ptr<poppler::document>& doc) {
-    if (!doc) {
-        return "";
+SecurityAnalyzer::PDFPass SecurityAnalyzer::scanPDFPages(ByteView pdf_data, poppler::document& doc, double threshold,
+                                                         const Ruleset& rules, const PDFScanOptions& options,
+                                                         AnalysisBudget* budget, const RuleProfile* profile) const {
+    PDFPass pass;
+    const int page_count = std::max(doc.pages(), 0);
+    const int limit = options.max_pages > 0 ? std::min(page_count, options.max_pages) : page_count;
+    const size_t window = overlapWindow(rules);
+    std::vector<PageScan> pages(page_count);
+
+    const bool timed = options.time_budget.count() > 0;
+    const auto deadline = std::chrono::steady_clock::now() + options.time_budget;
+    std::atomic<bool> stop{false};
+    std::atomic<bool> timed_out{false};
+    std::atomic<int> pages_analyzed{0};
+    // Union of the findings so far, to decide when the verdict is fixed
+    std::mutex progress_mutex;
+    Findings progress;
+
+    // Each page is scanned as soon as it is extracted; only its edges are
+    // kept, for the seams with its neighbours
+    auto scanPages = [&](poppler::document& source, int first, int last) {
+        // Reused for every page of the stripe, so it stops reallocating once
+        // it has grown to the largest page
+        std::string text;
+        for (int i = first; i < last; ++i) {
+            if (stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (timed && std::chrono::steady_clock::now() >= deadline) {
+                timed_out.store(true, std::memory_order_relaxed);
+                stop.store(true, std::memory_order_relaxed);
+                return;
+            }
+            if (budget && !budget->check()) {
+                stop.store(true, std::memory_order_relaxed);
+                return;
+            }
+            {
+                StageTimer timer(*metrics_, STAGE_EXTRACT_TEXT);
+                std::unique_ptr<poppler::page> page(source.create_page(i));
+                pages_analyzed.fetch_add(1, std::memory_order_relaxed);
+                metrics_->add(COUNTER_PAGES);
+                if (!page) {
+                    continue;
+                }
+                // Straight from poppler's UTF-16 into the buffer, normalized
+                // on the way; ASCII text needs exactly one byte per unit
+                const poppler::ustring units = page->text();
+                text.clear();
+                text.reserve(units.size());
+                appendNormalizedUtf8(units.data(), units.size(), text);
+            }
+            PageScan& out = pages[i];
+            out.size = text.size();
+            out.findings = scan(text, rules, options.collect_spans, budget, profile);
+            for (Span& span : out.findings.spans) {
+                span.page = i + 1;
+            }
+            out.head = pageEdge(text, window, true);
+            out.tail = pageEdge(text, window, false);
+
+            // The score only drops as findings accumulate, so once it is
+            // below the threshold no later page can change the verdict
+            if (options.stop_when_decided && (out.findings.hasPII() || out.findings.hasMaliciousContent())) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                progress.email = progress.email || out.findings.email;
+                progress.phone = progress.phone || out.findings.phone;
+                progress.ssn = progress.ssn || out.findings.ssn;
+                progress.malicious_patterns.insert(progress.malicious_patterns.end(),
+                    out.findings.malicious_patterns.begin(), out.findings.malicious_patterns.end());
+                if (calculateSafetyScore(progress, rules, profile) < threshold) {
+                    stop.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    const size_t stripes = limit <= PDF_PAGES_PER_TASK ? 1 :
+        std::min(workerPool().size() + 1, static_cast<size_t>((limit + PDF_PAGES_PER_TASK - 1) / PDF_PAGES_PER_TASK));
+    if (stripes == 1) {
+        scanPages(doc, 0, limit);
+    } else {
+        workerPool().parallelFor(stripes, [&](size_t stripe) {
+            const int first = static_cast<int>(limit * stripe / stripes);
+            const int last = static_cast<int>(limit * (stripe + 1) / stripes);
+            if (stripe == 0) {
+                scanPages(doc, first, last);
+                return;
+            }
+            // A poppler document must not be used from two threads at once,
+            // so every other stripe opens its own over the same bytes
+            auto own = loadPDF(pdf_data);
+            if (!own) {
+                throw std::runtime_error("failed to reopen PDF for parallel extraction");
+            }
+            scanPages(*own, first, last);
+        });
     }
-    
-    std::string text;
-    for (int i = 0; i < doc->pages(); ++i) {
-        std::unique_ptr<poppler::page> page(doc->create_page(i));
-        if (page) {
-            text += page->text().to_latin1();
+    pass.pages_analyzed = pages_analyzed.load();
+    // Stopping because the document is already unsafe is not a budget cut
+    pass.budget_exhausted = limit < page_count || timed_out.load();
+    if (pass.budget_exhausted && options.stop_when_decided && calculateSafetyScore(progress, rules, profile) < threshold) {
+        pass.budget_exhausted = false;
+    }
+
+    // Merge in page order, so each finding is attributed to the first page it
+    // appears on. A match across a page break is credited to its first page;
+    // the seam is merged after the later page, whose own matches take priority.
+    Findings& merged = pass.findings;
+    std::vector<int> first_hit_page(rules.patternCount(), 0);
+    for (int i = 0; i < page_count; ++i) {
+        pass.text_size += pages[i].size;
+#if SECURITY_ANALYZER_LOG_LEVEL >= 3
+        if (pass.preview.size() < 200) {
+            pass.preview += pages[i].head.substr(0, 200 - pass.preview.size());
+        }
+#endif
+        mergePageFindings(merged, first_hit_page, pages[i].findings, i + 1);
+        if (i > 0 && !pages[i - 1].tail.empty() && !pages[i].head.empty()) {
+            const PageScan& prev = pages[i - 1];
+            Findings seam = scan(prev.tail + pages[i].head, rules, options.collect_spans, budget, profile);
+            mergePageFindings(merged, first_hit_page, seam, i);
+            // Spans inside either page were found on that page already; only
+            // those across the break are new, placed on the earlier page
+            const size_t tail_start = prev.size - prev.tail.size();
+            for (const Span& span : seam.spans) {
+                if (span.begin < prev.tail.size() && span.end > prev.tail.size()) {
+                    merged.spans.push_back({span.kind, span.pattern_id, tail_start + span.begin,
+                                            tail_start + span.end, i});
+                }
+            }
+        }
+        merged.spans.insert(merged.spans.end(), pages[i].findings.spans.begin(), pages[i].findings.spans.end());
+    }
+    for (uint32_t id = 0; id < first_hit_page.size(); ++id) {
+        if (first_hit_page[id] != 0) {
+            merged.malicious_patterns.push_back(id);
+            merged.malicious_pages.push_back(first_hit_page[id]);
+        }
+    }
+    std::sort(merged.spans.begin(), merged.spans.end(), [](const Span& a, const Span& b) {
+        return std::tie(a.page, a.begin, a.end) < std::tie(b.page, b.begin, b.end);
+    });
+    return pass;
+}
+
+StreamingAnalyzer::StreamingAnalyzer(const SecurityAnalyzer& analyzer)
+    : analyzer_(analyzer),
+      rules_(analyzer.ruleset()),
+      threshold_(analyzer.getThreshold()),
+      window_(overlapWindow(*rules_)),
+      pattern_hit_(rules_->patternCount(), false) {
+    updateSettled();
+}
+
+void StreamingAnalyzer::feed(std::string_view chunk) {
+    if (finished_) {
+        throw std::logic_error("StreamingAnalyzer::feed called after finish");
+    }
+    const uint64_t chunk_offset = bytes_fed_;
+    bytes_fed_ += chunk.size();
+    if (settled_ || chunk.empty()) {
+        return;
+    }
+    analyzer_.metrics_->add(COUNTER_BYTES_SCANNED, chunk.size());
+
+    pending_.append(chunk.data(), chunk.size());
+    for (const auto& match : std::exchange(deferred_, {})) {
+        recordMatch(match.id, match.begin, match.end, false);
+    }
+
+    // pending_ still holds the window_ bytes before this chunk, so every
+    // match (no longer than window_) can be confirmed from it
+    rules_->scanChunk(chunk, matcher_state_, chunk_offset, [&](uint32_t id, size_t begin, size_t end) {
+        recordMatch(id, begin, end, false);
+        return true;
+    });
+
+    flushWindow(false);
+    updateSettled();
+}
+
+AnalysisResult StreamingAnalyzer::finish() {
+    if (finished_) {
+        return result_;
+    }
+    finished_ = true;
+    if (!settled_) {
+        for (const auto& match : std::exchange(deferred_, {})) {
+            recordMatch(match.id, match.begin, match.end, true);
         }
+        flushWindow(true);
+    }
+    pending_.clear();
+    pending_.shrink_to_fit();
+
+    std::sort(findings_.malicious_patterns.begin(), findings_.malicious_patterns.end());
+    analyzer_.metrics_->add(COUNTER_TEXTS);
+    analyzer_.recordFindings(findings_, *rules_);
+    result_.issues = analyzer_.describeFindings(findings_, *rules_);
+    result_.ruleset = rules_;
+    result_.confidence_score = analyzer_.calculateSafetyScore(findings_, *rules_);
+    result_.is_safe = result_.confidence_score >= threshold_;
+    result_.analysis_summary = std::string("Text analysis completed. ")
+        + (result_.is_safe ? "No security issues detected." : "Potential security issues identified.");
+    return result_;
+}
+
+void StreamingAnalyzer::recordMatch(uint32_t id, uint64_t begin, uint64_t end, bool end_of_stream) {
+    if (pattern_hit_[id]) {
+        return;
+    }
+    const size_t local_end = end - pending_offset_;
+    // A whole-word match at the end of the data so far waits for the next byte
+    if (!end_of_stream && local_end == pending_.size() && rules_->wholeWord(id)) {
+        deferred_.push_back({id, begin, end});
+        return;
+    }
+    if (rules_->confirm(id, pending_, begin - pending_offset_, local_end)) {
+        pattern_hit_[id] = true;
+        findings_.malicious_patterns.push_back(id);
     }
-    return text;
-} 
\ No newline at end of file
+}
+
+void StreamingAnalyzer::scanPII(std::string_view text) {
+    if (findings_.email && findings_.phone && findings_.ssn) {
+        return;
+    }
+    std::vector<bool> matched = rules_->piiEngine().match(text);
+    findings_.email = findings_.email || matched[PII_EMAIL];
+    findings_.phone = findings_.phone || matched[PII_PHONE];
+    findings_.ssn = findings_.ssn || matched[PII_SSN];
+}
+
+// Matches inside encoded runs, as the decoding pass of
+// detectMaliciousContent finds them; matches on plain bytes were already
+// reported by scanChunk and are skipped there
+void StreamingAnalyzer::scanEncoded(std::string_view text) {
+    std::vector<const std::vector<size_t>*> origins;
+    auto onMatch = [&](uint32_t id, size_t, size_t) {
+        if (!pattern_hit_[id]) {
+            pattern_hit_[id] = true;
+            findings_.malicious_patterns.push_back(id);
+        }
+        return true;
+    };
+    scanEncodedRuns(*rules_, text, origins, onMatch, nullptr);
+}
+
+// pending_ is [overlap window][unscanned bytes]. The PII engines report no
+// offsets and the encoded runs are found from their surroundings, so each
+// flush rescans the window together with the new bytes.
+void StreamingAnalyzer::flushWindow(bool end_of_stream) {
+    size_t cut = pending_.size();
+    if (!end_of_stream) {
+        if (pending_.size() - scanned_ < STREAM_FLUSH_SIZE) {
+            return;
+        }
+        // Cut just after whitespace: no PII pattern ends in whitespace, so
+        // the cut cannot complete a match that the next bytes would break,
+        // and base64 runs never cross it
+        size_t space = pending_.find_last_of(WHITESPACE);
+        if (space != std::string::npos && space >= scanned_) {
+            cut = space + 1;
+        } else if (pending_.size() < STREAM_MAX_PENDING) {
+            return;
+        }
+    }
+    scanPII(std::string_view(pending_).substr(0, cut));
+    scanEncoded(std::string_view(pending_).substr(0, cut));
+    if (end_of_stream) {
+        return;
+    }
+
+    // Keep window_ bytes before the cut, widened back to a token start so a
+    // rescan never begins inside a word
+    size_t keep_from = cut > window_ ? cut - window_ : 0;
+    const size_t limit = keep_from > window_ ? keep_from - window_ : 0;
+    while (keep_from > limit && !std::isspace(static_cast<unsigned char>(pending_[keep_from - 1]))) {
+        --keep_from;
+    }
+    pending_.erase(0, keep_from);
+    pending_offset_ += keep_from;
+    scanned_ = cut - keep_from;
+}
+
+// The score only ever drops as findings accumulate: the verdict is fixed
+// once it is already unsafe, or once even every detector firing would
+// leave it safe.
+void StreamingAnalyzer::updateSettled() {
+    settled_ = analyzer_.calculateSafetyScore(findings_, *rules_) < threshold_ ||
+               scoreAfter(rules_->maxMaliciousDeduction(), true, *rules_) >= threshold_;
+    if (settled_) {
+        pending_.clear();
+        pending_.shrink_to_fit();
+    }
+}
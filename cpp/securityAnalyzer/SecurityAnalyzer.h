@@ -1,39 +1,401 @@
 #pragma once
 
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <future>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <memory>
-#include <nlohmann/json.hpp>
+#include <mutex>
+#include <optional>
+#include "Metrics.h"
+#include "PDFStructure.h"
 
 // Forward declarations
 namespace poppler {
     class document;
 }
+class ThreadPool;
+class ResultCache;
+class Ruleset;
+class RuleProfile;
+
+// Non-owning view of raw document bytes (a C++17 stand-in for
+// std::span<const uint8_t>). Converts implicitly from std::vector<uint8_t>.
+struct ByteView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ByteView() = default;
+    ByteView(const uint8_t* bytes, size_t length) : data(bytes), size(length) {}
+    ByteView(const std::vector<uint8_t>& bytes) : data(bytes.data()), size(bytes.size()) {}
+};
+
+// What an issue record refers to
+enum IssueKind : uint8_t {
+    ISSUE_PII,  // generic flag ahead of the specific PII issues
+    ISSUE_EMAIL,
+    ISSUE_PHONE,
+    ISSUE_SSN,
+    ISSUE_PATTERN,  // a rule category, or one pattern of a report-each category
+    ISSUE_FILE_TOO_LARGE,
+    ISSUE_INVALID_PDF,
+    ISSUE_PDF_JAVASCRIPT,
+    ISSUE_PDF_LAUNCH,
+    ISSUE_PDF_EMBEDDED_FILES,
+    ISSUE_PDF_BUDGET_EXHAUSTED,
+    ISSUE_ANALYSIS_TIMEOUT,    // AnalysisOptions deadline or byte limit reached
+    ISSUE_ANALYSIS_CANCELLED,  // AnalysisOptions cancellation token set
+    ISSUE_ERROR,  // AnalysisResult::error
+};
+
+// Position of one match, for highlighting or redaction. Offsets are bytes
+// into the analyzed text; for PDFs, into the extracted text of page, and a
+// match across a page break starts on page and runs past its end.
+struct Span {
+    IssueKind kind;           // ISSUE_EMAIL, ISSUE_PHONE, ISSUE_SSN or ISSUE_PATTERN
+    uint32_t pattern_id = 0;  // ISSUE_PATTERN: the matched pattern (its category via Ruleset::rule)
+    size_t begin = 0;
+    size_t end = 0;
+    int page = 0;             // 1-based, PDF only
+};
+
+// Typed output of a single detection pass over a text. The safety score,
+// the issues and the summary are all derived from it.
+struct Findings {
+    bool email = false;
+    bool phone = false;
+    bool ssn = false;
+    std::vector<uint32_t> malicious_patterns;  // matched pattern ids, ascending
+
+    // 1-based page of the first occurrence, for findings from a PDF; 0 or
+    // empty otherwise. malicious_pages runs parallel to malicious_patterns.
+    int email_page = 0;
+    int phone_page = 0;
+    int ssn_page = 0;
+    std::vector<int> malicious_pages;
+
+    // Every match, in text order, when the pass was asked to collect them
+    std::vector<Span> spans;
+
+    bool hasPII() const { return email || phone || ssn; }
+    bool hasMaliciousContent() const { return !malicious_patterns.empty(); }
+};
+
+// One detected issue, in compact form. Its text is only built when asked for.
+struct Issue {
+    IssueKind kind;
+    uint32_t pattern_id = 0;  // ISSUE_PATTERN: the first matching pattern
+    int page = 0;             // 1-based page it was first found on; 0 if not tied to a page
+};
 
 struct AnalysisResult {
-    bool is_safe;
-    double confidence_score;
-    std::vector<std::string> detected_issues;
+    bool is_safe = false;
+    double confidence_score = 0.0;
+    std::vector<Issue> issues;
     std::string analysis_summary;
+    // PDF results only: pages that were extracted and scanned, and what the
+    // raw-byte pre-scan found
+    int pages_analyzed = 0;
+    PDFStructure pdf_structure;
+    // Only filled when asked for (analyzeTextSpans, PDFScanOptions::collect_spans)
+    std::vector<Span> spans;
+    // Names the patterns of ISSUE_PATTERN records
+    std::shared_ptr<const Ruleset> ruleset;
+    std::string error;
+
+    // Renders the issues as text, in order
+    std::vector<std::string> detectedIssues() const;
+    std::string describeIssue(const Issue& issue) const;
+    // Page of each issue, in the same order
+    std::vector<int> issuePages() const;
+};
+
+// Result cache counters
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+// Incremental PDF analysis: pages are extracted and scanned one at a time
+// until the verdict is decided or a budget runs out. Zero budgets are
+// unlimited. A document cut short by a budget is reported unsafe, since its
+// remaining pages were never checked.
+struct PDFScanOptions {
+    // Stop extracting once the document is certain to be unsafe; the issues
+    // found up to that point are reported
+    bool stop_when_decided = true;
+    int max_pages = 0;
+    std::chrono::milliseconds time_budget{0};
+    // Report the position of every match in AnalysisResult::spans
+    bool collect_spans = false;
+};
+
+// Set from any thread to make the analyses holding it stop early
+class CancellationToken {
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Limits on one analysis call. They are checked cooperatively: between
+// pages, between 64 KB chunks of the matcher and PII scans, and between
+// decoded runs; a single Poppler parse or page extraction is not
+// interrupted. An analysis that hits a limit stops and returns what it found
+// so far, marked unsafe with ISSUE_ANALYSIS_TIMEOUT ("analysis_timeout") or
+// ISSUE_ANALYSIS_CANCELLED. Results cut short are never cached.
+struct AnalysisOptions {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Bytes run through the malicious-pattern matcher, decoded runs
+    // included; 0 is unlimited
+    uint64_t max_bytes_scanned = 0;
+    std::shared_ptr<const CancellationToken> cancel;
+
+    // Options whose deadline is timeout from now
+    static AnalysisOptions withTimeout(std::chrono::milliseconds timeout);
+
+    bool unlimited() const {
+        return deadline == std::chrono::steady_clock::time_point::max() && max_bytes_scanned == 0 && !cancel;
+    }
 };
 
+// A named policy for analyzeText(text, profile_id): its own threshold, and
+// a selection of the analyzer's rules applied at scan time (see
+// RuleProfile), so tenants with different policies share one analyzer and
+// one copy of the compiled rules.
+struct AnalysisProfile {
+    double threshold = 0.8;
+    // Issue texts of the rule categories to run; empty runs them all
+    std::vector<std::string> categories;
+    // Issue text -> weight for every pattern of that category
+    std::unordered_map<std::string, double> weights;
+    bool detect_pii = true;
+};
+
+using AnalysisCallback = std::function<void(AnalysisResult)>;
+
+// Copy of text with the bytes of every span replaced by mask, built in one
+// allocation. Spans may overlap and come in any order; text must be the text
+// they were found in.
+std::string redact(std::string_view text, const std::vector<Span>& spans, char mask = '*');
+
+class AnalysisBudget;
+
+// Thread safety: one SecurityAnalyzer may be shared by any number of threads.
+// The compiled rules are immutable and reference counted, the detectors keep
+// all scratch state on the caller's stack, and the threshold and ruleset are
+// swapped atomically (each call reads them once, so a concurrent
+// setThreshold, setRuleset or setProfile applies to later calls only).
 class SecurityAnalyzer {
 public:
-    explicit SecurityAnalyzer(double threshold = 0.8);
+    // worker_threads sizes the pool behind the batch APIs and multi-page PDF
+    // extraction (0 = one per hardware thread); the pool is only started by
+    // the first call that needs it. cache_bytes > 0 enables a result cache of
+    // that size, keyed by content hash, threshold and ruleset version.
+    explicit SecurityAnalyzer(double threshold = 0.8, size_t worker_threads = 0, size_t cache_bytes = 0);
+    ~SecurityAnalyzer();
 
     void setThreshold(double threshold);
     double getThreshold() const;
 
-    AnalysisResult analyzeText(const std::string& text);
-    AnalysisResult analyzePDF(const std::vector<uint8_t>& pdf_data);
-    bool isContentSafe(const std::string& content, double threshold = 0.8);
+    // Swaps the detection rules atomically: calls already running finish on
+    // the rules they started with. Clears the result cache, whose entries
+    // would keep the old rules alive. Defaults to Ruleset::builtin().
+    void setRuleset(std::shared_ptr<const Ruleset> ruleset);
+    std::shared_ptr<const Ruleset> ruleset() const;
+
+    // Adds or replaces a profile. Profiles follow setRuleset: each is
+    // resolved again against the new rules. Throws std::invalid_argument if
+    // a category or weight names no category of the current rules, or a
+    // weight is outside [0, 1].
+    void setProfile(const std::string& profile_id, const AnalysisProfile& profile);
+    // False if there was no such profile
+    bool removeProfile(const std::string& profile_id);
+
+    // Inputs are borrowed views; nothing is copied before scanning
+    AnalysisResult analyzeText(std::string_view text) const;
+    AnalysisResult analyzeText(std::string_view text, const AnalysisOptions& limits) const;
+    // Under a profile from setProfile instead of the analyzer's threshold and
+    // full rules; throws std::invalid_argument for an unknown profile_id
+    AnalysisResult analyzeText(std::string_view text, const std::string& profile_id) const;
+    AnalysisResult analyzeText(std::string_view text, const std::string& profile_id,
+                               const AnalysisOptions& limits) const;
+    // analyzeText plus AnalysisResult::spans, from the same pass. Not cached.
+    AnalysisResult analyzeTextSpans(std::string_view text) const;
+    AnalysisResult analyzeTextSpans(std::string_view text, const AnalysisOptions& limits) const;
+    AnalysisResult analyzePDF(ByteView pdf_data) const;
+    AnalysisResult analyzePDF(ByteView pdf_data, const PDFScanOptions& options) const;
+    AnalysisResult analyzePDF(ByteView pdf_data, const PDFScanOptions& options, const AnalysisOptions& limits) const;
+    // As analyzeText with a profile_id: its threshold, categories and weights
+    AnalysisResult analyzePDF(ByteView pdf_data, const std::string& profile_id) const;
+    bool isContentSafe(std::string_view content, double threshold = 0.8) const;
+
+    // Memory-maps the file and scans it in place: content starting with the
+    // %PDF magic goes through analyzePDF, anything else through analyzeText
+    AnalysisResult analyzeFile(const std::string& path) const;
+    AnalysisResult analyzeFile(const std::string& path, const AnalysisOptions& limits) const;
+    AnalysisResult analyzeFile(const std::string& path, const std::string& profile_id) const;
+    AnalysisResult analyzeFile(const std::string& path, const std::string& profile_id,
+                               const AnalysisOptions& limits) const;
+
+    // Analyze many documents across the worker pool; results are in input order
+    std::vector<AnalysisResult> analyzeBatch(const std::vector<std::string_view>& texts) const;
+    std::vector<AnalysisResult> analyzePDFBatch(const std::vector<ByteView>& documents) const;
+    std::vector<AnalysisResult> analyzePDFBatch(const std::vector<std::vector<uint8_t>>& documents) const;
+
+    // analyzeText / analyzePDF queued on the worker pool, for callers that
+    // must not block. The input is borrowed: it must stay valid and unchanged
+    // until the result is ready. Tasks still queued when the analyzer is
+    // destroyed run before it goes. The callback forms call on_done on a
+    // worker thread; an exception from the analysis is reported as an
+    // ISSUE_ERROR result.
+    std::future<AnalysisResult> analyzeAsync(std::string_view text,
+                                             const AnalysisOptions& limits = AnalysisOptions()) const;
+    std::future<AnalysisResult> analyzePDFAsync(ByteView pdf_data,
+                                                const AnalysisOptions& limits = AnalysisOptions()) const;
+    void analyzeAsync(std::string_view text, const AnalysisOptions& limits, AnalysisCallback on_done) const;
+    void analyzePDFAsync(ByteView pdf_data, const AnalysisOptions& limits, AnalysisCallback on_done) const;
+
+    // All zero when the cache is disabled
+    CacheStats cacheStats() const;
+    void clearCache();
+
+    // Per-stage latency histograms and counters of every call on this
+    // analyzer so far; category counts are named after the current ruleset
+    MetricsSnapshot getMetrics() const;
     
 private:
-    double threshold_;
-    std::vector<std::string> detectPII(const std::string& text);
-    std::vector<std::string> detectMaliciousContent(const std::string& text);
-    double calculateSafetyScore(const std::string& text);
+    friend class StreamingAnalyzer;
+    // Lets the benchmarks time the detectors on their own
+    friend struct DetectorBench;
+
+    std::atomic<double> threshold_;
+    size_t worker_threads_;
+    mutable std::unique_ptr<ThreadPool> pool_;
+    mutable std::once_flag pool_once_;
+    std::unique_ptr<ResultCache> cache_;
+    std::unique_ptr<Metrics> metrics_;
+    std::shared_ptr<const Ruleset> ruleset_;  // accessed with std::atomic_load/atomic_store
+    struct ProfileTable;
+    std::shared_ptr<const ProfileTable> profiles_;  // accessed with std::atomic_load/atomic_store
+    std::mutex profiles_mutex_;  // serializes setRuleset and the profile writers
+    ThreadPool& workerPool() const;
+
+    // A budget, when given, is charged for the scan and may cut it short.
+    // A profile, when given, supplies the rules in place of ruleset().
+    AnalysisResult analyzeView(std::string_view text, double threshold, bool collect_spans = false,
+                               const AnalysisOptions* limits = nullptr,
+                               const RuleProfile* profile = nullptr) const;
+    // Throws std::invalid_argument for an unknown profile_id. The profile
+    // keeps its rules alive, whatever setProfile or setRuleset do meanwhile.
+    std::shared_ptr<const RuleProfile> findProfile(const std::string& profile_id, double& threshold) const;
+    Findings scan(std::string_view text, const Ruleset& rules, bool collect_spans = false,
+                  AnalysisBudget* budget = nullptr, const RuleProfile* profile = nullptr) const;
+    void detectPII(std::string_view text, const Ruleset& rules, Findings& findings, bool collect_spans = false,
+                   AnalysisBudget* budget = nullptr) const;
+    // With stop_below set, scanning ends at the first hit that takes the
+    // score below it. With a profile, matches of its disabled categories are
+    // dropped.
+    void detectMaliciousContent(std::string_view text, const Ruleset& rules, Findings& findings,
+                                std::optional<double> stop_below = std::nullopt,
+                                bool collect_spans = false, AnalysisBudget* budget = nullptr,
+                                const RuleProfile* profile = nullptr) const;
+    double calculateSafetyScore(const Findings& findings, const Ruleset& rules,
+                                const RuleProfile* profile = nullptr) const;
+    std::vector<Issue> describeFindings(const Findings& findings, const Ruleset& rules) const;
+    void recordFindings(const Findings& findings, const Ruleset& rules) const;
     
-    std::unique_ptr<poppler::document> loadPDF(const std::vector<uint8_t>& pdf_data);
-    std::string extractTextFromPDF(const std::unique_ptr<poppler::document>& doc);
+    // limits may be null for no limits
+    AnalysisResult analyzePDFWithin(ByteView pdf_data, const PDFScanOptions& options, double threshold,
+                                    const AnalysisOptions* limits, const RuleProfile* profile = nullptr) const;
+    AnalysisResult analyzeFileWithin(const std::string& path, double threshold, const AnalysisOptions* limits,
+                                     const RuleProfile* profile = nullptr) const;
+
+    std::unique_ptr<poppler::document> loadPDF(ByteView pdf_data) const;
+    // complete is cleared when the result reflects an error rather than the document
+    AnalysisResult runPDFAnalysis(ByteView pdf_data, const PDFScanOptions& options,
+                                  double threshold, const Ruleset& rules, bool& complete,
+                                  AnalysisBudget* budget, const RuleProfile* profile) const;
+    struct PDFPass {
+        Findings findings;
+        size_t text_size = 0;
+        std::string preview;        // start of the extracted text, for debug logging
+        int pages_analyzed = 0;
+        bool budget_exhausted = false;
+    };
+    // Extracts pages in parallel stripes and scans each as it is extracted
+    PDFPass scanPDFPages(ByteView pdf_data, poppler::document& doc, double threshold,
+                         const Ruleset& rules, const PDFScanOptions& options, AnalysisBudget* budget,
+                         const RuleProfile* profile) const;
+};
+
+// Incremental analysis of one text that arrives in chunks, e.g. a request
+// body read off the socket, with no overall size limit.
+//
+// The malicious-pattern automaton carries its state from chunk to chunk, and
+// the PII detectors and the encoded-run decoder rescan an overlap window (at
+// least as long as the longest pattern) around each boundary, so matches
+// that straddle chunks are found. Encoded runs are decoded a few KB at a
+// time, cut after whitespace where possible; a match in a run that crosses
+// a cut is found when its encoded bytes start within the window before the
+// cut. Memory stays bounded by the chunk size plus the window. Once the verdict
+// can no longer change, feed() stops scanning and settled() turns true; the
+// issues reported by finish() are then those found up to that point.
+//
+// A session is used by one thread at a time and must not outlive the
+// analyzer it was created from. The threshold and rules are read once, at
+// creation.
+class StreamingAnalyzer {
+public:
+    explicit StreamingAnalyzer(const SecurityAnalyzer& analyzer);
+
+    // Throws std::logic_error after finish()
+    void feed(std::string_view chunk);
+    // Flushes the window and returns the verdict; repeated calls return the same result
+    AnalysisResult finish();
+
+    bool settled() const { return settled_; }
+    uint64_t bytesFed() const { return bytes_fed_; }
+
+private:
+    void recordMatch(uint32_t id, uint64_t begin, uint64_t end, bool end_of_stream);
+    void scanPII(std::string_view text);
+    void scanEncoded(std::string_view text);
+    void flushWindow(bool end_of_stream);
+    void updateSettled();
+
+    const SecurityAnalyzer& analyzer_;
+    std::shared_ptr<const Ruleset> rules_;
+    double threshold_;
+    size_t window_;
+
+    Findings findings_;
+    std::vector<bool> pattern_hit_;
+    uint32_t matcher_state_ = 0;
+    // Whole-word matches waiting for the byte after them (stream offsets)
+    struct DeferredMatch {
+        uint32_t id;
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<DeferredMatch> deferred_;
+
+    // Stream bytes from pending_offset_ on
+    std::string pending_;
+    uint64_t pending_offset_ = 0;
+    size_t scanned_ = 0;  // pending_[0, scanned_) has been through the PII detectors
+    uint64_t bytes_fed_ = 0;
+
+    bool settled_ = false;
+    bool finished_ = false;
+    AnalysisResult result_;
 };
@@ -0,0 +1,97 @@
+#include "TextNormalizer.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// A replacement of 0 drops the character
+struct Fold {
+    uint16_t from;
+    char to;
+};
+
+// Sorted by code point
+constexpr Fold folds[] = {
+    {0x00A0, ' '},  {0x00AD, 0},    {0x02B9, '\''}, {0x02BA, '"'},  {0x02BC, '\''},
+    {0x02C2, '<'},  {0x02C3, '>'},  {0x02C8, '\''}, {0x02D0, ':'},
+    {0x0391, 'A'},  {0x0392, 'B'},  {0x0395, 'E'},  {0x0396, 'Z'},  {0x0397, 'H'},
+    {0x0399, 'I'},  {0x039A, 'K'},  {0x039C, 'M'},  {0x039D, 'N'},  {0x039F, 'O'},
+    {0x03A1, 'P'},  {0x03A4, 'T'},  {0x03A5, 'Y'},  {0x03A7, 'X'},  {0x03B1, 'a'},
+    {0x03B9, 'i'},  {0x03BD, 'v'},  {0x03BF, 'o'},  {0x03C1, 'p'},  {0x03C5, 'u'},
+    {0x0405, 'S'},  {0x0406, 'I'},  {0x0408, 'J'},  {0x0410, 'A'},  {0x0412, 'B'},
+    {0x0415, 'E'},  {0x041A, 'K'},  {0x041C, 'M'},  {0x041D, 'H'},  {0x041E, 'O'},
+    {0x0420, 'P'},  {0x0421, 'C'},  {0x0422, 'T'},  {0x0425, 'X'},  {0x0430, 'a'},
+    {0x0435, 'e'},  {0x043E, 'o'},  {0x0440, 'p'},  {0x0441, 'c'},  {0x0443, 'y'},
+    {0x0445, 'x'},  {0x0455, 's'},  {0x0456, 'i'},  {0x0458, 'j'},  {0x04BB, 'h'},
+    {0x0501, 'd'},  {0x051B, 'q'},  {0x051D, 'w'},
+    {0x2000, ' '},  {0x2001, ' '},  {0x2002, ' '},  {0x2003, ' '},  {0x2004, ' '},
+    {0x2005, ' '},  {0x2006, ' '},  {0x2007, ' '},  {0x2008, ' '},  {0x2009, ' '},
+    {0x200A, ' '},  {0x200B, 0},    {0x200C, 0},    {0x200D, 0},    {0x2010, '-'},
+    {0x2011, '-'},  {0x2012, '-'},  {0x2013, '-'},  {0x2014, '-'},  {0x2015, '-'},
+    {0x2018, '\''}, {0x2019, '\''}, {0x201A, ','},  {0x201B, '\''}, {0x201C, '"'},
+    {0x201D, '"'},  {0x201E, '"'},  {0x201F, '"'},  {0x2024, '.'},  {0x2032, '\''},
+    {0x2033, '"'},  {0x2035, '`'},  {0x2039, '<'},  {0x203A, '>'},  {0x2044, '/'},
+    {0x2060, 0},    {0x2212, '-'},  {0x2215, '/'},  {0x2216, '\\'}, {0x2223, '|'},
+    {0x2329, '<'},  {0x232A, '>'},  {0x27E8, '<'},  {0x27E9, '>'},  {0x3000, ' '},
+    {0x3008, '<'},  {0x3009, '>'},  {0xFE59, '('},  {0xFE5A, ')'},  {0xFE5F, '#'},
+    {0xFE60, '&'},  {0xFE62, '+'},  {0xFE63, '-'},  {0xFE64, '<'},  {0xFE65, '>'},
+    {0xFE66, '='},  {0xFE68, '\\'}, {0xFE69, '$'},  {0xFE6A, '%'},  {0xFEFF, 0},
+};
+
+constexpr bool foldsSorted() {
+    for (size_t i = 1; i < std::size(folds); ++i) {
+        if (folds[i - 1].from >= folds[i].from) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(foldsSorted(), "folds must be sorted by code point");
+
+void appendCodePoint(uint32_t cp, std::string& out) {
+    if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    }
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+}
+
+} // namespace
+
+void appendNormalizedUtf8(const uint16_t* units, size_t count, std::string& out) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint16_t unit = units[i];
+        if (unit < 0x80) {
+            out += static_cast<char>(unit);
+            continue;
+        }
+        if (unit >= 0xFF01 && unit <= 0xFF5E) {
+            out += static_cast<char>(unit - 0xFEE0);
+            continue;
+        }
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            if (unit <= 0xDBFF && i + 1 < count && units[i + 1] >= 0xDC00 && units[i + 1] <= 0xDFFF) {
+                appendCodePoint(0x10000 + ((unit - 0xD800) << 10) + (units[i + 1] - 0xDC00), out);
+                ++i;
+            } else {
+                appendCodePoint(0xFFFD, out);
+            }
+            continue;
+        }
+        const Fold* fold = std::lower_bound(std::begin(folds), std::end(folds), unit,
+                                            [](const Fold& f, uint16_t cp) { return f.from < cp; });
+        if (fold != std::end(folds) && fold->from == unit) {
+            if (fold->to != 0) {
+                out += fold->to;
+            }
+            continue;
+        }
+        appendCodePoint(unit, out);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Appends UTF-16 text (as poppler::ustring holds it) to out as UTF-8, in one
+// pass, folding the characters used to disguise ASCII payloads from the
+// byte-level detectors:
+//
+//  - full-width forms U+FF01..U+FF5E become their ASCII counterparts, and
+//    the ideographic and no-break spaces become ' '
+//  - Cyrillic and Greek letters that look like Latin ones become those
+//  - angle brackets, quotes, dashes, slashes and other punctuation lookalikes
+//    become the ASCII character they imitate
+//  - zero-width characters and soft hyphens are dropped
+//
+// Everything else is encoded unchanged; an unpaired surrogate becomes
+// U+FFFD. out is appended to, never shrunk, so one buffer can be reused
+// across pages.
+void appendNormalizedUtf8(const uint16_t* units, size_t count, std::string& out);
@@ -0,0 +1,111 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ThreadPool::ThreadPool(size_t threads, bool pin_to_cores) {
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    if (threads == 0) {
+        threads = cpus;
+    }
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { workerLoop(); });
+#ifdef __linux__
+        if (pin_to_cores) {
+            // Best effort: a CPU outside the allowed set just leaves the worker unpinned
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % cpus, &set);
+            pthread_setaffinity_np(workers_.back().native_handle(), sizeof(set), &set);
+        }
+#else
+        (void)pin_to_cores;
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    // Items are claimed from a shared counter and the caller waits for items,
+    // not for helper jobs: a helper that starts late (or is still queued
+    // behind the caller's own job) finds no work left and never touches body.
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    auto drain = [state, count, &body]() {
+        for (size_t i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1)) {
+            std::exception_ptr error;
+            try {
+                body(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            if (++state->done == count) {
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(workers_.size(), count - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        enqueue(drain);
+    }
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state, count]() { return state->done == count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
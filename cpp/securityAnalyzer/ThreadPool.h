@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads fed from a single FIFO queue.
+class ThreadPool {
+public:
+    // threads == 0 uses one worker per hardware thread. With pin_to_cores,
+    // worker i is bound to CPU i (modulo the CPU count) on Linux, so its
+    // caches stay warm with the rules it has been scanning with.
+    explicit ThreadPool(size_t threads = 0, bool pin_to_cores = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>;
+
+    // Runs body(0) .. body(count - 1) across the pool and the calling thread,
+    // returning once all have finished. The caller takes part in the work and
+    // never waits on queued jobs, so this is safe to call from inside a pool
+    // task. The first exception thrown by body is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    void enqueue(std::function<void()> job);
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+template <typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+}
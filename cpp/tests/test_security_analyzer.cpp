@@ -4,7 +4,27 @@
 #include <filesystem>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 #include "../securityAnalyzer/SecurityAnalyzer.h"
+#include "../securityAnalyzer/PatternMatcher.h"
+#include "../securityAnalyzer/ByteScan.h"
+#include "../securityAnalyzer/PatternEngine.h"
+#include "../securityAnalyzer/ThreadPool.h"
+#include "../securityAnalyzer/PDFStructure.h"
+#include "../securityAnalyzer/ResultCache.h"
+#include "../securityAnalyzer/Ruleset.h"
+#include "../securityAnalyzer/RulesetDirectory.h"
+#include "../securityAnalyzer/Metrics.h"
+#include "../securityAnalyzer/TextNormalizer.h"
+#include "../securityAnalyzer/EncodedRuns.h"
+#include "../securityAnalyzer/IpcProtocol.h"
+#include "../securityAnalyzer/AnalyzerServer.h"
 
 namespace fs = std::filesystem;
 
@@ -50,6 +70,26 @@ protected:
         file << header << body << contentObj << xref << trailer;
     }
     
+    // Same minimal layout with one page (and content stream) per entry
+    void createMultiPagePDF(const std::string& filename, const std::vector<std::string>& pages) {
+        std::ofstream file(test_data_dir / filename, std::ios::binary);
+        const int count = static_cast<int>(pages.size());
+        std::string kids;
+        for (int i = 0; i < count; ++i) {
+            kids += std::to_string(3 + 2 * i) + " 0 R ";
+        }
+        file << "%PDF-1.4\n"
+             << "1 0 obj << /Type /Catalog /Pages 2 0 R >> endobj\n"
+             << "2 0 obj << /Type /Pages /Count " << count << " /Kids [" << kids << "] >> endobj\n";
+        for (int i = 0; i < count; ++i) {
+            std::string stream = "BT /F1 12 Tf 10 100 Td (" + pages[i] + ") Tj ET";
+            file << 3 + 2 * i << " 0 obj << /Type /Page /Parent 2 0 R /MediaBox [0 0 300 144] /Contents "
+                 << 4 + 2 * i << " 0 R >> endobj\n"
+                 << 4 + 2 * i << " 0 obj << /Length " << stream.size() << " >> stream\n" << stream << "\nendstream endobj\n";
+        }
+        file << "trailer << /Size " << 3 + 2 * count << " /Root 1 0 R >>\n%%EOF";
+    }
+    
     std::vector<uint8_t> readFile(const std::string& filename) {
         std::ifstream file(filename, std::ios::binary | std::ios::ate);
         std::streamsize size = file.tellg();
@@ -73,9 +113,10 @@ TEST_F(SecurityAnalyzerTest, TestSafeText) {
 TEST_F(SecurityAnalyzerTest, TestSensitiveText) {
     auto result = analyzer.analyzeText("Please contact me at john.doe@example.com");
     EXPECT_FALSE(result.is_safe);
-    bool has_pii = std::find(result.detected_issues.begin(), 
-                           result.detected_issues.end(), 
-                           "PII detected") != result.detected_issues.end();
+    const auto issues = result.detectedIssues();
+    bool has_pii = std::find(issues.begin(), 
+                           issues.end(), 
+                           "PII detected") != issues.end();
     EXPECT_TRUE(has_pii);
 }
 
@@ -111,9 +152,10 @@ TEST_F(SecurityAnalyzerTest, TestLargeTextFileSizeExceeded) {
     std::string large_text(10 * 1024 * 1024 + 1, 'A');
     auto result = analyzer.analyzeText(large_text);
     EXPECT_FALSE(result.is_safe);
-    bool size_issue = std::find(result.detected_issues.begin(),
-                                result.detected_issues.end(),
-                                "File size exceeds maximum allowed size") != result.detected_issues.end();
+    const auto issues = result.detectedIssues();
+    bool size_issue = std::find(issues.begin(),
+                                issues.end(),
+                                "File size exceeds maximum allowed size") != issues.end();
     EXPECT_TRUE(size_issue);
 }
 
@@ -131,8 +173,9 @@ TEST_F(SecurityAnalyzerTest, TestSQLInjectionDetection) {
     for (const auto& attack : sql_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "SQL injection not detected: " << attack;
-        bool has_sql_injection = std::any_of(result.detected_issues.begin(), 
-                                           result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_sql_injection = std::any_of(issues.begin(), 
+                                           issues.end(),
                                            [](const std::string& issue) {
                                                return issue.find("SQL injection") != std::string::npos;
                                            });
@@ -153,8 +196,9 @@ TEST_F(SecurityAnalyzerTest, TestXSSDetection) {
     for (const auto& attack : xss_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "XSS not detected: " << attack;
-        bool has_xss = std::any_of(result.detected_issues.begin(), 
-                                 result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_xss = std::any_of(issues.begin(), 
+                                 issues.end(),
                                  [](const std::string& issue) {
                                      return issue.find("XSS") != std::string::npos;
                                  });
@@ -177,8 +221,9 @@ TEST_F(SecurityAnalyzerTest, TestCommandInjectionDetection) {
     for (const auto& attack : cmd_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "Command injection not detected: " << attack;
-        bool has_cmd_injection = std::any_of(result.detected_issues.begin(), 
-                                            result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_cmd_injection = std::any_of(issues.begin(), 
+                                            issues.end(),
                                             [](const std::string& issue) {
                                                 return issue.find("command injection") != std::string::npos;
                                             });
@@ -198,8 +243,9 @@ TEST_F(SecurityAnalyzerTest, TestNoSQLInjectionDetection) {
     for (const auto& attack : nosql_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "NoSQL injection not detected: " << attack;
-        bool has_nosql_injection = std::any_of(result.detected_issues.begin(), 
-                                              result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_nosql_injection = std::any_of(issues.begin(), 
+                                              issues.end(),
                                               [](const std::string& issue) {
                                                   return issue.find("NoSQL injection") != std::string::npos;
                                               });
@@ -220,8 +266,9 @@ TEST_F(SecurityAnalyzerTest, TestPathTraversalDetection) {
     for (const auto& attack : path_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "Path traversal not detected: " << attack;
-        bool has_path_traversal = std::any_of(result.detected_issues.begin(), 
-                                             result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_path_traversal = std::any_of(issues.begin(), 
+                                             issues.end(),
                                              [](const std::string& issue) {
                                                  return issue.find("path traversal") != std::string::npos;
                                              });
@@ -243,8 +290,9 @@ TEST_F(SecurityAnalyzerTest, TestTemplateInjectionDetection) {
     for (const auto& attack : template_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "Template injection not detected: " << attack;
-        bool has_template_injection = std::any_of(result.detected_issues.begin(), 
-                                                 result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_template_injection = std::any_of(issues.begin(), 
+                                                 issues.end(),
                                                  [](const std::string& issue) {
                                                      return issue.find("template injection") != std::string::npos;
                                                  });
@@ -266,8 +314,9 @@ TEST_F(SecurityAnalyzerTest, TestCodeExecutionDetection) {
     for (const auto& attack : exec_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "Code execution not detected: " << attack;
-        bool has_code_exec = std::any_of(result.detected_issues.begin(), 
-                                        result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_code_exec = std::any_of(issues.begin(), 
+                                        issues.end(),
                                         [](const std::string& issue) {
                                             return issue.find("code execution") != std::string::npos;
                                         });
@@ -286,8 +335,9 @@ TEST_F(SecurityAnalyzerTest, TestXMLXXEDetection) {
     for (const auto& attack : xml_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "XML/XXE not detected: " << attack;
-        bool has_xml_injection = std::any_of(result.detected_issues.begin(), 
-                                            result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_xml_injection = std::any_of(issues.begin(), 
+                                            issues.end(),
                                             [](const std::string& issue) {
                                                 return issue.find("XML") != std::string::npos || 
                                                        issue.find("XXE") != std::string::npos;
@@ -309,8 +359,9 @@ TEST_F(SecurityAnalyzerTest, TestLDAPInjectionDetection) {
     for (const auto& attack : ldap_attacks) {
         auto result = analyzer.analyzeText(attack);
         EXPECT_FALSE(result.is_safe) << "LDAP injection not detected: " << attack;
-        bool has_ldap_injection = std::any_of(result.detected_issues.begin(), 
-                                             result.detected_issues.end(),
+        const auto issues = result.detectedIssues();
+        bool has_ldap_injection = std::any_of(issues.begin(), 
+                                             issues.end(),
                                              [](const std::string& issue) {
                                                  return issue.find("LDAP injection") != std::string::npos;
                                              });
@@ -318,6 +369,1387 @@ TEST_F(SecurityAnalyzerTest, TestLDAPInjectionDetection) {
     }
 }
 
+TEST(PatternMatcherTest, TestFindsOverlappingPatternsWithOffsets) {
+    PatternMatcher matcher;
+    uint32_t he = matcher.addPattern("he");
+    uint32_t she = matcher.addPattern("she");
+    uint32_t hers = matcher.addPattern("hers");
+    uint32_t he_again = matcher.addPattern("he");
+    matcher.build();
+    EXPECT_EQ(matcher.maxPatternLength(), 4u);
+
+    auto matches = matcher.findAll("ushers");
+    ASSERT_EQ(matches.size(), 4u);
+    // "she" and both "he" ids end at offset 4, "hers" at 6
+    std::vector<uint32_t> at_four;
+    for (const auto& m : matches) {
+        if (m.end == 4) {
+            at_four.push_back(m.pattern_id);
+        }
+    }
+    std::sort(at_four.begin(), at_four.end());
+    EXPECT_EQ(at_four, (std::vector<uint32_t>{he, she, he_again}));
+    EXPECT_EQ(matches.back().pattern_id, hers);
+    EXPECT_EQ(matches.back().begin, 2u);
+    EXPECT_EQ(matches.back().end, 6u);
+}
+
+TEST(PatternMatcherTest, TestScanStopsWhenCallbackReturnsFalse) {
+    PatternMatcher matcher;
+    matcher.addPattern("a");
+    matcher.build();
+    int calls = 0;
+    matcher.scan("aaaa", [&calls](uint32_t, size_t, size_t) {
+        ++calls;
+        return false;
+    });
+    EXPECT_EQ(calls, 1);
+}
+
+TEST_F(SecurityAnalyzerTest, TestPerPatternIssuesReportedInRuleOrder) {
+    auto result = analyzer.analyzeText("chown(x); system(y); md5(z)");
+    std::vector<std::string> expected = {
+        "Potential code execution attempt detected: system(",
+        "Potential code execution attempt detected: chown(",
+        "Suspicious function detected: md5("
+    };
+    EXPECT_EQ(result.detectedIssues(), expected);
+}
+
+TEST_F(SecurityAnalyzerTest, TestTemplatePatternsAreCaseSensitive) {
+    auto has_template = [](const AnalysisResult& result) {
+        const auto issues = result.detectedIssues();
+        return std::find(issues.begin(), issues.end(),
+                         "Potential template injection attempt detected") != issues.end();
+    };
+    EXPECT_TRUE(has_template(analyzer.analyzeText("x = __globals__")));
+    EXPECT_FALSE(has_template(analyzer.analyzeText("x = __GLOBALS__")));
+}
+
+TEST_F(SecurityAnalyzerTest, TestIsContentSafeAgreesWithAnalyzeText) {
+    std::vector<std::string> inputs = {
+        "plain text",
+        "mail me: jane@example.org",
+        "<script>alert(1)</script>",
+        "call 555-234-5678 then ; rm -rf /"
+    };
+    for (const auto& input : inputs) {
+        EXPECT_EQ(analyzer.isContentSafe(input), analyzer.analyzeText(input).is_safe) << input;
+    }
+}
+
+TEST(PatternMatcherTest, TestCaseInsensitiveMatcherFoldsAsciiOnly) {
+    PatternMatcher matcher(true);
+    matcher.addPattern("select");
+    matcher.build();
+    EXPECT_EQ(matcher.findAll("SeLeCt").size(), 1u);
+    EXPECT_EQ(matcher.findAll("s\xc3\x89lect").size(), 0u);
+}
+
+TEST(ByteScanTest, TestFindFirstOfEveryOffset) {
+    ByteSet set;
+    set.add('<');
+    set.add(';');
+    set.add('\xe9');  // non-ASCII bytes are ignored
+    EXPECT_FALSE(set.contains('\xe9'));
+
+    // Cover the vector body, the scalar tail and every lane position
+    for (size_t size = 0; size < 100; ++size) {
+        std::string text(size, 'a');
+        EXPECT_EQ(findFirstOf(text, set), size) << byteScanKernel();
+        for (size_t pos = 0; pos < size; ++pos) {
+            std::string hit = text;
+            hit[pos] = (pos % 2) ? '<' : ';';
+            if (pos + 1 < size) {
+                hit[pos + 1] = '\xe9';
+            }
+            EXPECT_EQ(findFirstOf(hit, set), pos) << byteScanKernel() << " size=" << size;
+        }
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestPunctuationFreeTextStillMatchesPlainPatterns) {
+    auto result = analyzer.analyzeText("UNION ALL SELECT password FROM users");
+    EXPECT_FALSE(result.is_safe);
+    ASSERT_FALSE(result.detectedIssues().empty());
+    EXPECT_EQ(result.detectedIssues().front(), "Potential SQL injection attempt detected");
+}
+
+TEST(PatternEngineTest, TestBackendsAgree) {
+    std::vector<std::string> patterns = {
+        R"(\b\d{3}-\d{2}-\d{4}\b)",
+        R"([a-z]+@[a-z]+\.[a-z]{2,})",
+        R"(\b(?:\+\d{1,3}[\s\-\.])?\d{3}[\s\-\.]\d{3}[\s\-\.]\d{4}\b)"
+    };
+    auto boost_engine = makeBoostPatternEngine(patterns);
+    auto engine = createPatternEngine(patterns);
+    ASSERT_EQ(engine->patternCount(), patterns.size());
+
+    std::vector<std::string> inputs = {
+        "ssn 123-45-6789", "1123-45-6789", "x@y.io", "call +44 555 123 4567",
+        "555-123-45678", "no pii here", std::string(20000, '7') + "-12-3456",
+        "\xe9" "123-45-6789" "\xe9"
+    };
+    for (const auto& input : inputs) {
+        EXPECT_EQ(engine->match(input), boost_engine->match(input)) << engine->name() << ": " << input;
+    }
+}
+
+TEST(PatternEngineTest, TestFindAllLocatesEveryMatch) {
+    std::vector<std::string> patterns = {R"(\b\d{3}-\d{2}-\d{4}\b)", R"([a-z]+@[a-z]+\.io)"};
+    auto boost_engine = makeBoostPatternEngine(patterns);
+    auto engine = createPatternEngine(patterns);
+    const std::string text = "a@b.io 123-45-6789, 1123-45-6789 and 987-65-4321 c@d.io";
+    auto positions = [](const std::vector<RegexMatch>& matches) {
+        std::vector<std::tuple<uint32_t, size_t, size_t>> out;
+        for (const auto& m : matches) {
+            out.emplace_back(m.pattern, m.begin, m.end);
+        }
+        return out;
+    };
+    const std::vector<std::tuple<uint32_t, size_t, size_t>> expected = {
+        {0, 7, 18}, {0, 37, 48}, {1, 0, 6}, {1, 49, 55}};
+    EXPECT_EQ(positions(boost_engine->findAll(text)), expected);
+    EXPECT_EQ(positions(engine->findAll(text)), expected) << engine->name();
+    EXPECT_TRUE(engine->findAll("nothing").empty());
+}
+
+TEST(PatternEngineTest, TestUnsupportedSyntaxFallsBackToBoost) {
+    // Backreferences are not linear-time; the factory must still return an engine
+    auto engine = createPatternEngine({R"((ab)\1)"});
+    EXPECT_STREQ(engine->name(), "boost");
+    EXPECT_EQ(engine->match("xabab"), std::vector<bool>{true});
+}
+
+TEST(ThreadPoolTest, TestParallelForRunsEveryIndexOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> counts(1000);
+    pool.parallelFor(counts.size(), [&counts](size_t i) { counts[i]++; });
+    for (const auto& count : counts) {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPoolTest, TestNestedParallelForDoesNotDeadlock) {
+    ThreadPool pool(1);
+    std::atomic<int> total{0};
+    pool.submit([&]() {
+        pool.parallelFor(8, [&total](size_t) { total++; });
+    }).get();
+    EXPECT_EQ(total.load(), 8);
+}
+
+TEST(ThreadPoolTest, TestParallelForRethrows) {
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.parallelFor(10, [](size_t i) {
+        if (i == 7) {
+            throw std::runtime_error("boom");
+        }
+    }), std::runtime_error);
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalyzeBatchPreservesInputOrder) {
+    SecurityAnalyzer batch_analyzer(0.8, 3);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 50; ++i) {
+        texts.push_back(i % 3 == 0 ? "<script>alert(" + std::to_string(i) + ")</script>"
+                                   : "plain text number " + std::to_string(i));
+    }
+    std::vector<std::string_view> views(texts.begin(), texts.end());
+    auto results = batch_analyzer.analyzeBatch(views);
+    ASSERT_EQ(results.size(), texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        auto expected = analyzer.analyzeText(texts[i]);
+        EXPECT_EQ(results[i].is_safe, expected.is_safe) << i;
+        EXPECT_EQ(results[i].detectedIssues(), expected.detectedIssues()) << i;
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalyzePDFBatch) {
+    createTestPDF("batch_safe.pdf", "A harmless report.");
+    createTestPDF("batch_bad.pdf", "Send it to admin@example.com");
+    std::vector<std::vector<uint8_t>> documents = {
+        readFile((test_data_dir / "batch_safe.pdf").string()),
+        readFile((test_data_dir / "batch_bad.pdf").string())
+    };
+    auto results = analyzer.analyzePDFBatch(documents);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_TRUE(results[0].is_safe);
+    EXPECT_FALSE(results[1].is_safe);
+}
+
+TEST_F(SecurityAnalyzerTest, TestConcurrentUseOfSharedInstance) {
+    std::vector<std::string> inputs = {
+        "This is a safe text message.",
+        "Please contact me at john.doe@example.com",
+        "'; DROP TABLE users; --",
+        "call 555-234-5678 or eval(atob(x))"
+    };
+    std::vector<AnalysisResult> expected;
+    for (const auto& input : inputs) {
+        expected.push_back(analyzer.analyzeText(input));
+    }
+
+    // Toggle between thresholds that give identical verdicts for scores 0, 0.5 and 1
+    std::atomic<bool> done{false};
+    std::thread toggler([&]() {
+        while (!done) {
+            analyzer.setThreshold(0.9);
+            analyzer.setThreshold(0.8);
+        }
+    });
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < 200; ++i) {
+                size_t k = (t + i) % inputs.size();
+                auto result = analyzer.analyzeText(inputs[k]);
+                if (result.is_safe != expected[k].is_safe ||
+                    result.detectedIssues() != expected[k].detectedIssues()) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    done = true;
+    toggler.join();
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalyzeTextHonoursViewBounds) {
+    // Only the first 13 bytes are in view; the script tag after them must not be seen
+    std::string buffer = "harmless text<script>alert(1)</script>";
+    auto result = analyzer.analyzeText(std::string_view(buffer.data(), 13));
+    EXPECT_TRUE(result.is_safe);
+    EXPECT_TRUE(result.detectedIssues().empty());
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalyzePDFFromByteView) {
+    createTestPDF("view.pdf", "This is a safe PDF document.");
+    auto pdf_bytes = readFile((test_data_dir / "view.pdf").string());
+    auto result = analyzer.analyzePDF(ByteView(pdf_bytes.data(), pdf_bytes.size()));
+    EXPECT_TRUE(result.is_safe);
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalyzeFileDetectsTypeFromContent) {
+    createTestFile("script.txt", "<script>alert(1)</script>");
+    createTestPDF("report.pdf", "This is a safe PDF document.");
+    createTestFile("empty.txt", "");
+
+    auto text_result = analyzer.analyzeFile((test_data_dir / "script.txt").string());
+    EXPECT_FALSE(text_result.is_safe);
+    EXPECT_EQ(text_result.analysis_summary.rfind("Text analysis", 0), 0u);
+
+    auto pdf_result = analyzer.analyzeFile((test_data_dir / "report.pdf").string());
+    EXPECT_TRUE(pdf_result.is_safe);
+    EXPECT_EQ(pdf_result.analysis_summary.rfind("PDF analysis", 0), 0u);
+
+    EXPECT_TRUE(analyzer.analyzeFile((test_data_dir / "empty.txt").string()).is_safe);
+
+    auto missing = analyzer.analyzeFile((test_data_dir / "missing.txt").string());
+    EXPECT_FALSE(missing.is_safe);
+    ASSERT_EQ(missing.detectedIssues().size(), 1u);
+    EXPECT_EQ(missing.detectedIssues()[0].rfind("Error reading file", 0), 0u);
+}
+
+namespace {
+
+AnalysisResult analyzeInChunks(const SecurityAnalyzer& analyzer, std::string_view text, size_t chunk_size) {
+    StreamingAnalyzer stream(analyzer);
+    for (size_t offset = 0; offset < text.size(); offset += chunk_size) {
+        stream.feed(text.substr(offset, chunk_size));
+    }
+    return stream.finish();
+}
+
+} // namespace
+
+TEST_F(SecurityAnalyzerTest, TestStreamingMatchesAcrossChunkBoundaries) {
+    // Enough padding that the PII window is flushed and rescanned mid-stream
+    const std::string padding(5000, ' ');
+    const std::vector<std::string> texts = {
+        padding + "x'; DROP TABLE users; --" + padding,
+        padding + "call me at 555-123-4567 tomorrow" + padding,
+        padding + "reference x123-45-6789y only" + padding,
+        padding + "plain words with nothing to report" + padding,
+    };
+    for (const auto& text : texts) {
+        auto expected = analyzer.analyzeText(text);
+        for (size_t chunk_size : {1, 7, 4096, 5003, 100000}) {
+            auto streamed = analyzeInChunks(analyzer, text, chunk_size);
+            EXPECT_EQ(streamed.is_safe, expected.is_safe) << "chunk size " << chunk_size;
+            EXPECT_EQ(streamed.confidence_score, expected.confidence_score) << "chunk size " << chunk_size;
+        }
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestStreamingDecodesEncodedRunsLikeAnalyzeText) {
+    const std::string padding(5000, ' ');
+    const std::vector<std::string> payloads = {
+        "%3Cscript%3Ealert(1)%3C%2Fscript%3E",
+        "&lt;script&gt;document.cookie&lt;/script&gt;",
+        "q=%2527%2520or%25201%253D1--",
+        "data PHNjcmlwdD5hbGVydCgxKTwvc2NyaXB0Pg== end",
+        "path=%2E%2E%2F%2E%2E%2Fetc%2Fpasswd",
+    };
+    for (const auto& payload : payloads) {
+        // Alone, where the decoder runs at finish(), and deep in a stream
+        // that is flushed and cut around it
+        for (const std::string& text : {payload, padding + payload + padding}) {
+            auto expected = analyzer.analyzeText(text);
+            ASSERT_FALSE(expected.is_safe) << payload;
+            for (size_t chunk_size : {1, 3, 7, 4096, 5003, 100000}) {
+                auto streamed = analyzeInChunks(analyzer, text, chunk_size);
+                EXPECT_EQ(streamed.detectedIssues(), expected.detectedIssues())
+                    << payload << " chunk size " << chunk_size;
+                EXPECT_EQ(streamed.confidence_score, expected.confidence_score)
+                    << payload << " chunk size " << chunk_size;
+            }
+        }
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestStreamingStopsOnceVerdictIsFixed) {
+    StreamingAnalyzer stream(analyzer);
+    stream.feed("harmless start ");
+    EXPECT_FALSE(stream.settled());
+    stream.feed("<script>alert(1)</script>");
+    EXPECT_TRUE(stream.settled());
+    stream.feed("more data that is no longer scanned");
+    EXPECT_EQ(stream.bytesFed(), 75u);
+
+    auto result = stream.finish();
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_FALSE(result.detectedIssues().empty());
+    EXPECT_THROW(stream.feed("late"), std::logic_error);
+}
+
+TEST_F(SecurityAnalyzerTest, TestStreamingHasNoSizeLimit) {
+    const std::string chunk(64 * 1024, 'a');
+    StreamingAnalyzer stream(analyzer);
+    for (size_t fed = 0; fed <= static_cast<size_t>(10 * 1024 * 1024); fed += chunk.size()) {
+        stream.feed(chunk);
+    }
+    auto result = stream.finish();
+    EXPECT_TRUE(result.is_safe);
+    EXPECT_TRUE(result.detectedIssues().empty());
+}
+
+TEST_F(SecurityAnalyzerTest, TestIsContentSafeEarlyExitHonoursBothThresholds) {
+    std::vector<std::string> inputs = {
+        "plain text",
+        "<script>alert(1)</script>",
+        "<script>alert(1)</script> and 123-45-6789",
+        "mail jane@example.org"
+    };
+    for (double threshold : {0.0, 0.5, 0.8}) {
+        SecurityAnalyzer tuned(threshold);
+        for (const auto& input : inputs) {
+            const double score = tuned.analyzeText(input).confidence_score;
+            EXPECT_EQ(tuned.isContentSafe(input, 0.0), score >= threshold) << input;
+            EXPECT_EQ(tuned.isContentSafe(input, 0.5), score >= std::max(threshold, 0.5)) << input;
+        }
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestMultiPagePDFReportsFirstPageOfEachIssue) {
+    // Enough pages to be extracted in parallel stripes
+    std::vector<std::string> pages(40, "An ordinary page of a long report.");
+    pages[6] = "Contact jane@example.org for details.";
+    pages[21] = "Run base64_decode on it.";
+    pages[33] = "And base64_decode again.";
+    createMultiPagePDF("long.pdf", pages);
+
+    SecurityAnalyzer pooled(0.8, 4);
+    auto result = pooled.analyzePDF(readFile((test_data_dir / "long.pdf").string()));
+    EXPECT_FALSE(result.is_safe);
+    ASSERT_EQ(result.issuePages().size(), result.detectedIssues().size());
+
+    auto pageOf = [&](const std::string& issue) {
+        const auto issues = result.detectedIssues();
+        auto it = std::find(issues.begin(), issues.end(), issue);
+        return it == issues.end() ? -1 : result.issuePages()[it - issues.begin()];
+    };
+    EXPECT_EQ(pageOf("PII detected"), 7);
+    EXPECT_EQ(pageOf("Email address detected"), 7);
+    EXPECT_EQ(pageOf("Potential code execution attempt detected: base64_decode"), 22);
+}
+
+TEST_F(SecurityAnalyzerTest, TestPDFMatchAcrossPageBreak) {
+    std::vector<std::string> pages(12, "filler text");
+    pages[3] = "the end of this page reads <scr";
+    pages[4] = "ipt src=x> on the next";
+    createMultiPagePDF("split.pdf", pages);
+
+    auto result = analyzer.analyzePDF(readFile((test_data_dir / "split.pdf").string()));
+    EXPECT_FALSE(result.is_safe);
+    ASSERT_FALSE(result.issuePages().empty());
+    EXPECT_EQ(result.issuePages()[0], 4);
+}
+
+TEST_F(SecurityAnalyzerTest, TestIncrementalPDFStopsAtDecidingPage) {
+    std::vector<std::string> pages(8, "An ordinary page of a long report.");
+    pages[1] = "<script src=x></script>";
+    pages[6] = "Contact jane@example.org for details.";
+    createMultiPagePDF("decided.pdf", pages);
+    auto data = readFile((test_data_dir / "decided.pdf").string());
+
+    auto full = analyzer.analyzePDF(data);
+    EXPECT_EQ(full.pages_analyzed, 8);
+
+    auto incremental = analyzer.analyzePDF(data, PDFScanOptions());
+    EXPECT_FALSE(incremental.is_safe);
+    EXPECT_EQ(incremental.pages_analyzed, 2);
+    const auto issues = incremental.detectedIssues();
+    EXPECT_EQ(std::count(issues.begin(), issues.end(), "PII detected"), 0);
+}
+
+TEST_F(SecurityAnalyzerTest, TestIncrementalPDFPageBudgetFailsClosed) {
+    createMultiPagePDF("budget.pdf", std::vector<std::string>(8, "An ordinary page of a long report."));
+    auto data = readFile((test_data_dir / "budget.pdf").string());
+
+    PDFScanOptions options;
+    options.max_pages = 3;
+    auto result = analyzer.analyzePDF(data, options);
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.pages_analyzed, 3);
+    ASSERT_EQ(result.detectedIssues().size(), 1u);
+    EXPECT_EQ(result.detectedIssues()[0], "PDF analysis budget exhausted before the last page");
+
+    options.max_pages = 8;
+    EXPECT_TRUE(analyzer.analyzePDF(data, options).is_safe);
+}
+
+TEST(PDFStructureTest, TestFindsActionNamesAsWholeTokens) {
+    auto structure = scanPDFStructure(
+        "%PDF-1.7\n1 0 obj << /OpenAction 2 0 R /AA << /O 3 0 R >> >> endobj\n"
+        "2 0 obj << /S /J#61vaScript >> endobj\n3 0 obj << /Type /JSON >> endobj\n%%EOF");
+    EXPECT_TRUE(structure.javascript);
+    EXPECT_TRUE(structure.open_action);
+    EXPECT_TRUE(structure.additional_actions);
+    EXPECT_FALSE(structure.launch);
+    EXPECT_EQ(structure.object_count, 3u);
+    EXPECT_TRUE(structure.has_eof);
+
+    auto plain = scanPDFStructure("%PDF-1.7\n1 0 obj << /Type /JSON /AAPL 1 >> endobj\n%%EOF");
+    EXPECT_FALSE(plain.javascript);
+    EXPECT_FALSE(plain.additional_actions);
+}
+
+TEST(PDFStructureTest, TestSkipsStreamDataAndChecksXref) {
+    const std::string head = "%PDF-1.7\n1 0 obj << /Length 9 >> stream\n/JS /Launch\nendstream endobj\n";
+    const std::string pdf = head + "xref\n0 2\ntrailer << /Root 1 0 R >>\nstartxref\n" +
+                            std::to_string(head.size()) + "\n%%EOF";
+    auto structure = scanPDFStructure(pdf);
+    EXPECT_FALSE(structure.javascript);
+    EXPECT_FALSE(structure.launch);
+    EXPECT_TRUE(structure.xref_valid);
+
+    auto broken = scanPDFStructure(head + "startxref\n999999\n%%EOF");
+    EXPECT_FALSE(broken.xref_valid);
+}
+
+TEST(PDFStructureTest, TestSkipsLiteralAndHexStrings) {
+    // A '%' inside a string does not start a comment that would hide /JS
+    auto percent = scanPDFStructure("%PDF-1.7\n1 0 obj << /Title (50%) /S /JavaScript /JS (app.alert(1)) >> endobj\n%%EOF");
+    EXPECT_TRUE(percent.javascript);
+
+    auto quoted = scanPDFStructure("%PDF-1.7\n1 0 obj << /Title (about /JS in docs) >> endobj\n%%EOF");
+    EXPECT_FALSE(quoted.javascript);
+
+    // Nested and escaped parentheses, and hex strings next to dictionaries
+    auto nested = scanPDFStructure(
+        "%PDF-1.7\n1 0 obj << /Title (a (nested /Launch) \\) /JS) /ID <2F4A53> /S /Launch >> endobj\n%%EOF");
+    EXPECT_FALSE(nested.javascript);
+    EXPECT_TRUE(nested.launch);
+    EXPECT_EQ(nested.object_count, 1u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestPDFWithJavaScriptRejectedBeforeParsing) {
+    std::string pdf = "%PDF-1.4\n1 0 obj << /Type /Catalog /OpenAction << /S /JavaScript /JS (app.alert) >> >> endobj\n"
+                      "2 0 obj << /Length 28 >> stream\nBT (Quarterly figures) Tj ET\nendstream endobj\n%%EOF";
+    std::vector<uint8_t> data(pdf.begin(), pdf.end());
+    auto result = analyzer.analyzePDF(data);
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.pages_analyzed, 0);
+    EXPECT_EQ(result.detectedIssues(), std::vector<std::string>{"PDF contains JavaScript"});
+    EXPECT_TRUE(result.pdf_structure.open_action);
+
+    std::string no_objects = "%PDF-1.4\njust some bytes\n%%EOF";
+    auto junk = analyzer.analyzePDF(std::vector<uint8_t>(no_objects.begin(), no_objects.end()));
+    EXPECT_EQ(junk.detectedIssues(), std::vector<std::string>{"invalid_or_corrupted_pdf"});
+}
+
+TEST_F(SecurityAnalyzerTest, TestStaleXrefIsRecordedNotRejected) {
+    // An offset into the middle of an object, as a naive edit leaves it;
+    // Poppler repairs that, so the pre-scan only notes it
+    createTestPDF("stale_xref.pdf", "This is a safe PDF document.");
+    auto pdf = readFile((test_data_dir / "stale_xref.pdf").string());
+    std::string bytes(pdf.begin(), pdf.end());
+    bytes.replace(bytes.find("startxref 310"), 13, "startxref 20");
+    auto result = analyzer.analyzePDF(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+    EXPECT_TRUE(result.is_safe);
+    EXPECT_TRUE(result.pdf_structure.has_startxref);
+    EXPECT_FALSE(result.pdf_structure.xref_valid);
+    EXPECT_TRUE(result.pdf_structure.has_eof);
+
+    auto truncated = scanPDFStructure("%PDF-1.4\n1 0 obj << /Type /Catalog /Pages 2 0 R >> endobj\n");
+    EXPECT_FALSE(truncated.has_startxref);
+    EXPECT_FALSE(truncated.has_eof);
+    EXPECT_EQ(truncated.object_count, 1u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestResultCacheHitsAndKeys) {
+    SecurityAnalyzer cached(0.8, 1, 1 << 20);
+    const std::string text = "select * from users where id = 1 or 1=1";
+    auto first = cached.analyzeText(text);
+    auto second = cached.analyzeText(text);
+    EXPECT_EQ(second.detectedIssues(), first.detectedIssues());
+    EXPECT_EQ(second.confidence_score, first.confidence_score);
+    EXPECT_EQ(cached.cacheStats().hits, 1u);
+    EXPECT_EQ(cached.cacheStats().misses, 1u);
+
+    // The threshold is part of the key
+    cached.setThreshold(0.4);
+    EXPECT_TRUE(cached.analyzeText(text).is_safe);
+    EXPECT_EQ(cached.cacheStats().misses, 2u);
+
+    createTestPDF("cached.pdf", "This is a safe PDF document.");
+    auto pdf = readFile((test_data_dir / "cached.pdf").string());
+    cached.analyzePDF(pdf);
+    EXPECT_TRUE(cached.analyzePDF(pdf).is_safe);
+    EXPECT_EQ(cached.cacheStats().hits, 2u);
+    EXPECT_EQ(cached.cacheStats().entries, 3u);
+
+    cached.clearCache();
+    EXPECT_EQ(cached.cacheStats().entries, 0u);
+    EXPECT_EQ(analyzer.cacheStats().hits, 0u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestResultCacheLetsGoOfSwappedRulesets) {
+    SecurityAnalyzer cached(0.8, 1, 1 << 20);
+    std::weak_ptr<const Ruleset> old_rules;
+    {
+        auto rules = Ruleset::compile(Ruleset::builtinCategories());
+        old_rules = rules;
+        cached.setRuleset(std::move(rules));
+        cached.analyzeText("select * from users where id = 1 or 1=1");
+        EXPECT_EQ(cached.cacheStats().entries, 1u);
+    }
+    EXPECT_FALSE(old_rules.expired());
+
+    cached.setRuleset(Ruleset::builtin());
+    EXPECT_EQ(cached.cacheStats().entries, 0u);
+    EXPECT_TRUE(old_rules.expired());
+}
+
+TEST(ResultCacheTest, TestEvictsLeastRecentlyUsedWithinBudget) {
+    ResultCache cache(2048, 1);
+    AnalysisResult result;
+    result.analysis_summary = "cached";
+    auto keyFor = [](const std::string& content) {
+        CacheKey key;
+        hashContent(content, key.hash_lo, key.hash_hi);
+        key.size = content.size();
+        return key;
+    };
+
+    for (int i = 0; i < 100; ++i) {
+        cache.insert(keyFor("document " + std::to_string(i)), result, cache.generation());
+        AnalysisResult out;
+        EXPECT_TRUE(cache.lookup(keyFor("document 0"), out));  // keep the first one hot
+    }
+    auto stats = cache.stats();
+    EXPECT_LE(stats.bytes, 2048u);
+    EXPECT_LT(stats.entries, 100u);
+
+    AnalysisResult out;
+    EXPECT_TRUE(cache.lookup(keyFor("document 0"), out));
+    EXPECT_EQ(out.analysis_summary, "cached");
+    EXPECT_FALSE(cache.lookup(keyFor("document 1"), out));
+
+    // Spans count against the budget
+    AnalysisResult spanned = result;
+    spanned.spans.resize(2048 / sizeof(Span));
+    cache.insert(keyFor("spanned"), spanned, cache.generation());
+    EXPECT_FALSE(cache.lookup(keyFor("spanned"), out));
+
+    // A result computed across a clear() is not stored
+    const uint64_t generation = cache.generation();
+    cache.clear();
+    cache.insert(keyFor("late"), result, generation);
+    EXPECT_FALSE(cache.lookup(keyFor("late"), out));
+    EXPECT_EQ(cache.stats().entries, 0u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestCustomRulesetHotSwap) {
+    const std::string text = "please wire the funds to account 42";
+    auto builtin = analyzer.ruleset();
+    EXPECT_TRUE(analyzer.analyzeText(text).is_safe);
+
+    RuleCategory fraud;
+    fraud.issue = "Potential fraud detected";
+    fraud.patterns = {"wire the funds"};
+    auto custom = Ruleset::compile({fraud});
+    EXPECT_NE(custom->version(), builtin->version());
+    EXPECT_EQ(custom->patternCount(), 1u);
+
+    analyzer.setRuleset(custom);
+    auto result = analyzer.analyzeText("Please WIRE THE FUNDS today");
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.detectedIssues(), std::vector<std::string>{"Potential fraud detected"});
+    EXPECT_TRUE(analyzer.analyzeText("'; DROP TABLE users; --").is_safe);
+
+    analyzer.setRuleset(builtin);
+    EXPECT_TRUE(analyzer.analyzeText(text).is_safe);
+    EXPECT_FALSE(analyzer.analyzeText("'; DROP TABLE users; --").is_safe);
+    EXPECT_THROW(analyzer.setRuleset(nullptr), std::invalid_argument);
+    EXPECT_THROW(Ruleset::compile({RuleCategory{"Empty", false, false, {""}}}), std::invalid_argument);
+}
+
+TEST_F(SecurityAnalyzerTest, TestRulesetSwapDuringAnalysis) {
+    RuleCategory fraud;
+    fraud.issue = "Potential fraud detected";
+    fraud.patterns = {"wire the funds"};
+    auto custom = Ruleset::compile({fraud});
+    auto builtin = Ruleset::builtin();
+    const std::string text = "'; DROP TABLE users; -- then wire the funds";
+    const auto with_builtin = analyzer.analyzeText(text).detectedIssues();
+    const std::vector<std::string> with_custom{"Potential fraud detected"};
+
+    std::atomic<bool> done{false};
+    std::thread swapper([&]() {
+        while (!done) {
+            analyzer.setRuleset(custom);
+            analyzer.setRuleset(builtin);
+        }
+    });
+
+    // Every call sees one ruleset or the other, never a mix
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < 200; ++i) {
+                auto issues = analyzer.analyzeText(text).detectedIssues();
+                if (issues != with_builtin && issues != with_custom) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    done = true;
+    swapper.join();
+    EXPECT_EQ(mismatches.load(), 0);
+
+    // The ruleset version is part of the cache key
+    SecurityAnalyzer cached(0.8, 1, 1 << 20);
+    cached.analyzeText(text);
+    cached.setRuleset(custom);
+    EXPECT_EQ(cached.analyzeText(text).detectedIssues(), with_custom);
+    EXPECT_EQ(cached.cacheStats().hits, 0u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestKeywordFileMatchesWholeWords) {
+    createTestFile("keywords.json", R"(["hell", "shut up", "mkdir("])");
+    auto categories = loadRuleCategories((test_data_dir / "keywords.json").string());
+    ASSERT_EQ(categories.size(), 1u);
+    EXPECT_TRUE(categories[0].whole_word);
+    EXPECT_EQ(categories[0].issue, KEYWORD_ISSUE);
+
+    analyzer.setRuleset(Ruleset::load({(test_data_dir / "keywords.json").string()}));
+    const std::vector<std::string> keyword_issue{KEYWORD_ISSUE};
+    EXPECT_EQ(analyzer.analyzeText("What the HELL is this").detectedIssues(), keyword_issue);
+    EXPECT_EQ(analyzer.analyzeText("Oh, shut up.").detectedIssues(), keyword_issue);
+    EXPECT_TRUE(analyzer.analyzeText("Hello, shell user").is_safe);
+    EXPECT_TRUE(analyzer.analyzeText("hell_fire and shut upstairs").is_safe);
+    // Only word-character edges need a boundary
+    EXPECT_FALSE(analyzer.analyzeText("run xmkdir(a)").is_safe);
+    // The built-in rules are still there
+    EXPECT_FALSE(analyzer.analyzeText("<script>").is_safe);
+
+    // Word boundaries are checked across streaming chunks too
+    StreamingAnalyzer split(analyzer);
+    split.feed("go to hel");
+    split.feed("l");
+    split.feed("o world");
+    EXPECT_TRUE(split.finish().is_safe);
+    StreamingAnalyzer tail(analyzer);
+    tail.feed("go to hell");
+    EXPECT_EQ(tail.finish().detectedIssues(), keyword_issue);
+}
+
+TEST_F(SecurityAnalyzerTest, TestLoadCustomRuleFile) {
+    createTestFile("rules.json", R"([
+        {"issue": "Internal project name leaked", "patterns": ["ProjectX"], "case_sensitive": true},
+        {"issue": "Credential detected: ", "patterns": ["api_key", "secret"], "report_each_pattern": true, "whole_word": true}
+    ])");
+    auto categories = loadRuleCategories((test_data_dir / "rules.json").string());
+    ASSERT_EQ(categories.size(), 2u);
+    EXPECT_TRUE(categories[0].case_sensitive);
+    EXPECT_FALSE(categories[0].whole_word);
+
+    analyzer.setRuleset(Ruleset::compile(categories));
+    auto result = analyzer.analyzeText("ProjectX uses api_key=1 and a secret");
+    EXPECT_EQ(result.detectedIssues(), (std::vector<std::string>{
+        "Internal project name leaked", "Credential detected: api_key", "Credential detected: secret"}));
+    EXPECT_TRUE(analyzer.analyzeText("projectx secretary").is_safe);
+
+    createTestFile("broken.json", R"([{"patterns": ["x"]}])");
+    EXPECT_THROW(loadRuleCategories((test_data_dir / "broken.json").string()), std::runtime_error);
+    EXPECT_THROW(loadRuleCategories((test_data_dir / "missing.json").string()), std::runtime_error);
+}
+
+TEST_F(SecurityAnalyzerTest, TestCompiledRulesetFileRoundTrip) {
+    createTestFile("keywords.json", R"(["hell", "shut up"])");
+    auto compiled = Ruleset::load({(test_data_dir / "keywords.json").string()});
+    const std::string path = (test_data_dir / "rules.bin").string();
+    compiled->save(path);
+
+    auto opened = Ruleset::open(path);
+    EXPECT_NE(opened->version(), compiled->version());
+    EXPECT_EQ(opened->patternCount(), compiled->patternCount());
+    ASSERT_EQ(opened->categories().size(), compiled->categories().size());
+    EXPECT_TRUE(opened->categories().back().whole_word);
+
+    SecurityAnalyzer reference;
+    reference.setRuleset(compiled);
+    analyzer.setRuleset(opened);
+    for (const std::string text : {"Oh, shut up.", "Hello, shell user", "'; DROP TABLE users; --",
+                                   "{{ 7*7 }} then eval(atob(x))", "Please contact me at john.doe@example.com",
+                                   "This is a safe text message."}) {
+        auto expected = reference.analyzeText(text);
+        auto actual = analyzer.analyzeText(text);
+        EXPECT_EQ(actual.detectedIssues(), expected.detectedIssues()) << text;
+        EXPECT_EQ(actual.is_safe, expected.is_safe) << text;
+    }
+}
+
+TEST_F(SecurityAnalyzerTest, TestCorruptRulesetFileRejected) {
+    const std::string path = (test_data_dir / "rules.bin").string();
+    Ruleset::builtin()->save(path);
+    const auto bytes = readFile(path);
+    auto expectRejected = [&](std::vector<uint8_t> corrupt) {
+        createTestFile("corrupt.bin", std::string(corrupt.begin(), corrupt.end()));
+        EXPECT_THROW(Ruleset::open((test_data_dir / "corrupt.bin").string()), std::runtime_error);
+    };
+
+    auto bad_magic = bytes;
+    bad_magic[0] = 'X';
+    expectRejected(bad_magic);
+    auto other_version = bytes;
+    other_version[8] ^= 0xff;
+    expectRejected(other_version);
+    expectRejected(std::vector<uint8_t>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+    // The middle of the file is in the main transition table
+    auto bad_transition = bytes;
+    std::fill_n(bad_transition.begin() + (bytes.size() / 2 & ~size_t{3}), 4, 0xff);
+    expectRejected(bad_transition);
+    EXPECT_THROW(Ruleset::open((test_data_dir / "missing.bin").string()), std::runtime_error);
+
+    auto reopened = Ruleset::open(path);
+    analyzer.setRuleset(reopened);
+    EXPECT_FALSE(analyzer.analyzeText("<script>alert(1)</script>").is_safe);
+}
+
+TEST_F(SecurityAnalyzerTest, TestIssueRecordsRenderLazily) {
+    auto result = analyzer.analyzeText("mail jane@example.org the md5(x) and sha1(y) sums");
+    ASSERT_EQ(result.issues.size(), 4u);
+    EXPECT_EQ(result.issues[0].kind, ISSUE_PII);
+    EXPECT_EQ(result.issues[1].kind, ISSUE_EMAIL);
+    EXPECT_EQ(result.issues[2].kind, ISSUE_PATTERN);
+    EXPECT_EQ(result.describeIssue(result.issues[1]), "Email address detected");
+    EXPECT_EQ(result.detectedIssues(), (std::vector<std::string>{
+        "PII detected", "Email address detected",
+        "Suspicious function detected: md5(", "Suspicious function detected: sha1("}));
+
+    // Rendering uses the rules the result was produced with
+    RuleCategory other;
+    other.issue = "Other";
+    other.patterns = {"unrelated"};
+    analyzer.setRuleset(Ruleset::compile({other}));
+    EXPECT_EQ(result.describeIssue(result.issues[3]), "Suspicious function detected: sha1(");
+
+    auto missing = analyzer.analyzeFile((test_data_dir / "missing.txt").string());
+    ASSERT_EQ(missing.issues.size(), 1u);
+    EXPECT_EQ(missing.issues[0].kind, ISSUE_ERROR);
+    EXPECT_EQ(missing.detectedIssues()[0].rfind("Error reading file: ", 0), 0u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestSpansAndRedaction) {
+    const std::string text = "Mail jane@example.org or call 555-234-5678; then <script>x</script>";
+    auto plain = analyzer.analyzeText(text);
+    EXPECT_TRUE(plain.spans.empty());
+
+    auto result = analyzer.analyzeTextSpans(text);
+    EXPECT_EQ(result.detectedIssues(), plain.detectedIssues());
+    auto find = [&](IssueKind kind, const std::string& matched) {
+        return std::any_of(result.spans.begin(), result.spans.end(), [&](const Span& span) {
+            return span.kind == kind && text.substr(span.begin, span.end - span.begin) == matched;
+        });
+    };
+    EXPECT_TRUE(find(ISSUE_EMAIL, "jane@example.org"));
+    EXPECT_TRUE(find(ISSUE_PHONE, "555-234-5678"));
+    EXPECT_TRUE(find(ISSUE_PATTERN, "<script"));
+    EXPECT_TRUE(find(ISSUE_PATTERN, "</script>"));
+    EXPECT_TRUE(std::is_sorted(result.spans.begin(), result.spans.end(), [](const Span& a, const Span& b) {
+        return a.begin < b.begin;
+    }));
+    for (const auto& span : result.spans) {
+        if (span.kind == ISSUE_PATTERN) {
+            EXPECT_EQ(result.ruleset->pattern(span.pattern_id).size(), span.end - span.begin);
+        }
+    }
+
+    std::vector<Span> pii;
+    std::copy_if(result.spans.begin(), result.spans.end(), std::back_inserter(pii),
+                 [](const Span& span) { return span.kind != ISSUE_PATTERN; });
+    EXPECT_EQ(redact(text, pii), "Mail **************** or call ************; then <script>x</script>");
+    EXPECT_EQ(redact(text, result.spans, '#').find("script"), std::string::npos);
+}
+
+TEST_F(SecurityAnalyzerTest, TestPDFSpansCarryPages) {
+    std::vector<std::string> pages(12, "filler text");
+    pages[2] = "Contact jane@example.org today";
+    pages[3] = "the end of this page reads <scr";
+    pages[4] = "ipt src=x> on the next";
+    createMultiPagePDF("spans.pdf", pages);
+
+    PDFScanOptions options;
+    options.stop_when_decided = false;
+    options.collect_spans = true;
+    auto result = analyzer.analyzePDF(readFile((test_data_dir / "spans.pdf").string()), options);
+    ASSERT_EQ(result.spans.size(), 2u);
+    EXPECT_EQ(result.spans[0].kind, ISSUE_EMAIL);
+    EXPECT_EQ(result.spans[0].page, 3);
+    EXPECT_EQ(result.spans[0].begin, 8u);
+    EXPECT_EQ(result.spans[0].end, 24u);
+    // Across the page break: starts on page 4 and runs past its end
+    EXPECT_EQ(result.spans[1].kind, ISSUE_PATTERN);
+    EXPECT_EQ(result.spans[1].page, 4);
+    EXPECT_EQ(result.spans[1].begin, pages[3].size() - 4);
+    EXPECT_EQ(result.spans[1].end, pages[3].size() + 3);
+}
+
+TEST_F(SecurityAnalyzerTest, TestMetricsCountStages) {
+    SecurityAnalyzer fresh(0.8, 2);
+    fresh.analyzeText("Mail jane@example.org about <script>");
+    std::vector<std::string> texts(40, "plain words and nothing else");
+    fresh.analyzeBatch(std::vector<std::string_view>(texts.begin(), texts.end()));
+    createMultiPagePDF("metrics.pdf", {"first page", "second page", "third page"});
+    fresh.analyzePDF(readFile((test_data_dir / "metrics.pdf").string()));
+
+    MetricsSnapshot metrics = fresh.getMetrics();
+    EXPECT_EQ(metrics.texts_analyzed, 41u);
+    EXPECT_EQ(metrics.pdfs_analyzed, 1u);
+    EXPECT_EQ(metrics.pages_extracted, 3u);
+    EXPECT_EQ(metrics.email_found, 1u);
+    EXPECT_EQ(metrics.phone_found, 0u);
+    EXPECT_EQ(metrics.stages[STAGE_ANALYZE_TEXT].count, 41u);
+    EXPECT_EQ(metrics.stages[STAGE_LOAD_PDF].count, 1u);
+    EXPECT_EQ(metrics.stages[STAGE_EXTRACT_TEXT].count, 3u);
+    // Three pages plus two seams, plus the texts
+    EXPECT_EQ(metrics.stages[STAGE_DETECT_PII].count, 46u);
+    EXPECT_GE(metrics.bytes_scanned, 40u * texts[0].size());
+    const StageMetrics& text_stage = metrics.stages[STAGE_ANALYZE_TEXT];
+    EXPECT_LE(text_stage.percentileNs(0.5), text_stage.percentileNs(0.99));
+    EXPECT_LE(text_stage.percentileNs(1.0), text_stage.max_ns);
+    EXPECT_GT(text_stage.total_ns, 0u);
+
+    ASSERT_EQ(metrics.category_matches.size(), fresh.ruleset()->categories().size());
+    uint64_t xss = 0;
+    for (const auto& [issue, count] : metrics.category_matches) {
+        if (issue == "Potential XSS attack detected") {
+            xss = count;
+        }
+    }
+    EXPECT_EQ(xss, 1u);
+
+    // Another analyzer's calls are not counted here
+    analyzer.analyzeText("unrelated");
+    EXPECT_EQ(fresh.getMetrics().texts_analyzed, 41u);
+}
+
+TEST(MetricsTest, TestPercentilesFromBuckets) {
+    Metrics metrics;
+    for (int i = 0; i < 99; ++i) {
+        metrics.recordLatency(STAGE_DETECT_PII, std::chrono::nanoseconds(1000));
+    }
+    metrics.recordLatency(STAGE_DETECT_PII, std::chrono::nanoseconds(1000000));
+    const StageMetrics stage = metrics.snapshot({}).stages[STAGE_DETECT_PII];
+    EXPECT_EQ(stage.count, 100u);
+    EXPECT_EQ(stage.total_ns, 99u * 1000 + 1000000);
+    EXPECT_EQ(stage.max_ns, 1000000u);
+    EXPECT_EQ(stage.percentileNs(0.5), 1024u);
+    EXPECT_EQ(stage.percentileNs(0.99), 1024u);
+    EXPECT_EQ(stage.percentileNs(1.0), 1000000u);
+}
+
+TEST(TextNormalizerTest, TestFoldsDisguisedAscii) {
+    auto normalize = [](const std::u16string& text) {
+        std::string out = "kept:";
+        appendNormalizedUtf8(reinterpret_cast<const uint16_t*>(text.data()), text.size(), out);
+        return out;
+    };
+    EXPECT_EQ(normalize(u"\uff1cscript\uff1e"), "kept:<script>");
+    // Cyrillic and Greek lookalikes, zero-width joiners, a full-width space
+    EXPECT_EQ(normalize(u"\u0455\u0441r\u0456\u0440t \u03bfn\u200bclick=\u3000x"), "kept:script onclick= x");
+    EXPECT_EQ(normalize(u"\u2039svg \u2215\u203a \u2018 or \u20181\u2019=\u20191"), "kept:<svg /> ' or '1'='1");
+    // Everything else is plain UTF-8, including pairs outside the BMP
+    EXPECT_EQ(normalize(u"caf\u00e9 \u65e5\u672c \U0001F600"), "kept:caf\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x98\x80");
+    const uint16_t lone[] = {'a', 0xD800, 'b', 0xDC00};
+    std::string out;
+    appendNormalizedUtf8(lone, 4, out);
+    EXPECT_EQ(out, "a\xef\xbf\xbd" "b\xef\xbf\xbd");
+}
+
+TEST_F(SecurityAnalyzerTest, TestPDFUnicodeObfuscationIsCaught) {
+    createMultiPagePDF("unicode.pdf", {"A plain first page",
+                                       "Say \xef\xbc\x9cscript\xef\xbc\x9e and \xd0\xb0" "dmin*",
+                                       "Caf\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac"});
+    PDFScanOptions options;
+    options.stop_when_decided = false;
+    options.collect_spans = true;
+    auto result = analyzer.analyzePDF(readFile((test_data_dir / "unicode.pdf").string()), options);
+    EXPECT_FALSE(result.is_safe);
+    const auto issues = result.detectedIssues();
+    EXPECT_NE(std::find(issues.begin(), issues.end(), "Potential XSS attack detected"), issues.end());
+    EXPECT_NE(std::find(issues.begin(), issues.end(), "Potential LDAP injection attempt detected"), issues.end());
+    for (const auto& span : result.spans) {
+        EXPECT_EQ(span.page, 2);
+    }
+}
+
+TEST(EncodedRunsTest, TestDecodesRunsWithOrigins) {
+    const std::string text = "go to java%73cript:x and then, much later, &lt;b&gt; and PHNjcmlwdD5hbGVydCgxKTwvc2NyaXB0Pg== ok";
+    EncodedRunFinder finder(text);
+    DecodedRun run;
+    std::vector<std::string> decoded;
+    while (finder.next(run)) {
+        ASSERT_EQ(run.origin.size(), run.text.size() + 1);
+        EXPECT_EQ(run.origin.front(), run.begin);
+        EXPECT_EQ(run.origin.back(), run.end);
+        decoded.push_back(run.text);
+    }
+    EXPECT_EQ(decoded, (std::vector<std::string>{"javascript:x", "<b>", "<script>alert(1)</script>"}));
+
+    // Lone escape characters, long words and binary base64 are not runs
+    EncodedRunFinder none("100% sure & internationalization 2f1c8e0b9a7d4c3e5f6a");
+    EXPECT_FALSE(none.next(run));
+}
+
+TEST_F(SecurityAnalyzerTest, TestEncodedPayloadsAreDecoded) {
+    auto expectIssue = [&](const std::string& text, const std::string& issue) {
+        auto result = analyzer.analyzeText(text);
+        const auto issues = result.detectedIssues();
+        EXPECT_NE(std::find(issues.begin(), issues.end(), issue), issues.end()) << text;
+        EXPECT_FALSE(analyzer.isContentSafe(text)) << text;
+    };
+    expectIssue("q=%3Cscript%3Ealert%281%29", "Potential XSS attack detected");
+    expectIssue("say &lt;script&gt; now", "Potential XSS attack detected");
+    expectIssue("&#x3c;script&#62;", "Potential XSS attack detected");
+    expectIssue("payload JyBvciAxPTEtLQ== here", "Potential SQL injection attempt detected");
+    // Two layers: base64 of URL-encoded text, and a doubly URL-encoded slash
+    expectIssue("data JTNDc2NyaXB0JTNF", "Potential XSS attack detected");
+    expectIssue("GET /..%252f..%252fetc", "Potential path traversal attempt detected");
+
+    EXPECT_TRUE(analyzer.analyzeText("Save 20% on orders &amp; returns, see internationalization notes").is_safe);
+
+    // Spans point at the encoded bytes in the original text
+    const std::string text = "x=%3Cscript%3E";
+    auto result = analyzer.analyzeTextSpans(text);
+    ASSERT_FALSE(result.spans.empty());
+    EXPECT_EQ(text.substr(result.spans[0].begin, result.spans[0].end - result.spans[0].begin), "%3Cscript");
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalysisLimitsCutShortAndFailClosed) {
+    std::string text;
+    while (text.size() < 1024 * 1024) {
+        text += "An ordinary sentence of a long upload. ";
+    }
+    text += "<script>alert(1)</script>";
+
+    AnalysisOptions expired;
+    expired.deadline = std::chrono::steady_clock::now();
+    auto result = analyzer.analyzeText(text, expired);
+    EXPECT_FALSE(result.is_safe);
+    ASSERT_FALSE(result.detectedIssues().empty());
+    EXPECT_EQ(result.detectedIssues().back(), "analysis_timeout");
+
+    AnalysisOptions small;
+    small.max_bytes_scanned = 128 * 1024;
+    result = analyzer.analyzeText(text, small);
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.detectedIssues().back(), "analysis_timeout");
+
+    auto token = std::make_shared<CancellationToken>();
+    token->cancel();
+    AnalysisOptions cancelled;
+    cancelled.cancel = token;
+    result = analyzer.analyzeText(text, cancelled);
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.detectedIssues().back(), "analysis_cancelled");
+
+    // A cut-short result was not cached, and generous limits change nothing
+    const auto unlimited = analyzer.analyzeText(text);
+    const auto generous = analyzer.analyzeText(text, AnalysisOptions::withTimeout(std::chrono::minutes(1)));
+    EXPECT_EQ(generous.detectedIssues(), unlimited.detectedIssues());
+    EXPECT_EQ(generous.confidence_score, unlimited.confidence_score);
+    EXPECT_EQ(analyzer.getMetrics().analyses_cut_short, 3u);
+}
+
+TEST_F(SecurityAnalyzerTest, TestAnalysisLimitsChunkedScanMatchesFullScan) {
+    // Matches straddling the 64 KB boundaries must be found as in one pass
+    std::string text;
+    while (text.size() < 4 * 64 * 1024) {
+        text += "filler ";
+    }
+    const std::string script = " <script>alert(1)";
+    const std::string email = " jane@example.org ";
+    text.replace(64 * 1024 - 7, script.size(), script);
+    text.replace(2 * 64 * 1024 - 7, email.size(), email);
+    AnalysisOptions generous;
+    generous.max_bytes_scanned = 1ull << 30;
+    const auto limited = analyzer.analyzeText(text, generous);
+    const auto full = analyzer.analyzeText(text);
+    EXPECT_EQ(limited.detectedIssues(), full.detectedIssues());
+    EXPECT_FALSE(full.detectedIssues().empty());
+}
+
+TEST_F(SecurityAnalyzerTest, TestPDFAnalysisDeadlineFailsClosed) {
+    createMultiPagePDF("deadline.pdf", std::vector<std::string>(20, "An ordinary page of a long report."));
+    auto data = readFile((test_data_dir / "deadline.pdf").string());
+
+    PDFScanOptions full;
+    full.stop_when_decided = false;
+    AnalysisOptions expired;
+    expired.deadline = std::chrono::steady_clock::now();
+    auto result = analyzer.analyzePDF(data, full, expired);
+    EXPECT_FALSE(result.is_safe);
+    EXPECT_EQ(result.pages_analyzed, 0);
+    EXPECT_EQ(result.detectedIssues().back(), "analysis_timeout");
+
+    EXPECT_TRUE(analyzer.analyzePDF(data, full, AnalysisOptions::withTimeout(std::chrono::minutes(1))).is_safe);
+}
+
+TEST(IpcProtocolTest, TestFramesRoundTripAndArriveInPieces) {
+    IpcRequest request;
+    request.id = 7;
+    request.op = IPC_ANALYZE_TEXT;
+    request.flags = IPC_FLAG_SPANS;
+    request.timeout_ms = 250;
+    request.payload = "Mail jane@example.org";
+    std::string wire;
+    appendRequest(request, wire);
+    appendRequest(request, wire);
+
+    IpcRequest parsed;
+    EXPECT_EQ(parseRequest(std::string_view(wire).substr(0, 10), parsed), 0u);
+    const size_t size = parseRequest(wire, parsed);
+    ASSERT_EQ(size, wire.size() / 2);
+    EXPECT_EQ(parsed.id, 7u);
+    EXPECT_EQ(parsed.op, IPC_ANALYZE_TEXT);
+    EXPECT_EQ(parsed.flags, IPC_FLAG_SPANS);
+    EXPECT_EQ(parsed.timeout_ms, 250u);
+    EXPECT_EQ(parsed.payload, "Mail jane@example.org");
+
+    IpcResponse response;
+    response.id = 7;
+    response.confidence_score = 0.375;
+    response.issues = {"Email address detected"};
+    response.spans.push_back({ISSUE_EMAIL, 0, 5, 21, 0});
+    response.summary = "done";
+    wire.clear();
+    appendResponse(response, wire);
+    IpcResponse decoded;
+    ASSERT_EQ(parseResponse(wire, decoded), wire.size());
+    EXPECT_EQ(decoded.confidence_score, 0.375);
+    EXPECT_EQ(decoded.issues, response.issues);
+    ASSERT_EQ(decoded.spans.size(), 1u);
+    EXPECT_EQ(decoded.spans[0].end, 21u);
+    EXPECT_EQ(decoded.summary, "done");
+
+    // A size past the limit is rejected before any of it is buffered
+    const std::string huge("\xff\xff\xff\x7f", 4);
+    EXPECT_THROW(parseRequest(huge, parsed), std::runtime_error);
+}
+
+TEST_F(SecurityAnalyzerTest, TestServerAnswersOverUnixSocket) {
+    ServerOptions options;
+    const std::string name = "analyzer_test_" + std::to_string(::getpid()) + ".sock";
+    options.socket_path = (fs::temp_directory_path() / name).string();
+    options.workers = 2;
+    options.pin_workers = false;
+    AnalyzerServer server(analyzer, options);
+    std::thread loop([&server]() { server.run(); });
+
+    {
+        AnalyzerClient client(server.socketPath());
+        EXPECT_EQ(client.call(IPC_PING, "").status, IPC_OK);
+
+        const std::string text = "Send the SSN 123-45-6789 to admin@example.com";
+        const IpcResponse response = client.call(IPC_ANALYZE_TEXT, text, 0, IPC_FLAG_SPANS);
+        const AnalysisResult local = analyzer.analyzeTextSpans(text);
+        EXPECT_EQ(response.status, IPC_OK);
+        EXPECT_EQ(response.is_safe, local.is_safe);
+        EXPECT_EQ(response.confidence_score, local.confidence_score);
+        EXPECT_EQ(response.issues, local.detectedIssues());
+        EXPECT_EQ(response.spans.size(), local.spans.size());
+
+        createTestPDF("served.pdf", "Send it to admin@example.com");
+        const auto pdf = readFile((test_data_dir / "served.pdf").string());
+        const IpcResponse pdf_response =
+            client.call(IPC_ANALYZE_PDF, std::string_view(reinterpret_cast<const char*>(pdf.data()), pdf.size()));
+        EXPECT_FALSE(pdf_response.is_safe);
+        EXPECT_EQ(pdf_response.pages_analyzed, 1u);
+
+        EXPECT_EQ(client.call(static_cast<IpcOp>(9), "x").status, IPC_BAD_REQUEST);
+    }
+
+    // Several clients at once, each with its own connection
+    std::vector<std::thread> clients;
+    std::atomic<int> answered{0};
+    for (int i = 0; i < 4; ++i) {
+        clients.emplace_back([&]() {
+            AnalyzerClient client(server.socketPath());
+            for (int j = 0; j < 25; ++j) {
+                if (client.call(IPC_ANALYZE_TEXT, "an ordinary line " + std::to_string(j)).is_safe) {
+                    ++answered;
+                }
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(answered.load(), 100);
+
+    server.stop();
+    loop.join();
+}
+
+TEST_F(SecurityAnalyzerTest, TestAsyncAnalysisMatchesBlocking) {
+    SecurityAnalyzer pooled(0.8, 2);
+    const std::string text = "Mail jane@example.org about <script>alert(1)</script>";
+    auto future = pooled.analyzeAsync(text);
+    const AnalysisResult blocking = pooled.analyzeText(text);
+    const AnalysisResult async = future.get();
+    EXPECT_EQ(async.is_safe, blocking.is_safe);
+    EXPECT_EQ(async.detectedIssues(), blocking.detectedIssues());
+
+    createTestPDF("async.pdf", "Send it to admin@example.com");
+    const auto pdf = readFile((test_data_dir / "async.pdf").string());
+    EXPECT_FALSE(pooled.analyzePDFAsync(pdf).get().is_safe);
+
+    // Callbacks arrive on the workers, one per call
+    std::vector<std::string> texts;
+    for (int i = 0; i < 20; ++i) {
+        texts.push_back(i % 2 ? "harmless line" : "call 555-123-4567");
+    }
+    std::mutex mutex;
+    std::condition_variable cv;
+    int done = 0;
+    int unsafe = 0;
+    for (const auto& item : texts) {
+        pooled.analyzeAsync(item, AnalysisOptions(), [&](AnalysisResult result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            unsafe += result.is_safe ? 0 : 1;
+            ++done;
+            cv.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return done == 20; });
+    EXPECT_EQ(unsafe, 10);
+}
+
+TEST_F(SecurityAnalyzerTest, TestWeightedCategoriesScore) {
+    createTestFile("weighted.json", R"([
+        {"issue": "Coupon spam", "patterns": ["coupon"], "weight": 0.1},
+        {"issue": "Payment fraud", "patterns": ["wire the funds", "gift card"], "weight": 0.4,
+         "pattern_weights": {"gift card": 0.3}},
+        {"issue": "Pressure", "patterns": ["act now"], "weight": 0.3}
+    ])");
+    auto categories = loadRuleCategories((test_data_dir / "weighted.json").string());
+    ASSERT_EQ(categories.size(), 3u);
+    EXPECT_EQ(categories[1].pattern_weights, (std::vector<double>{0.4, 0.3}));
+    auto compiled = Ruleset::compile(categories);
+    const std::string path = (test_data_dir / "weighted.bin").string();
+    compiled->save(path);
+
+    for (const auto& rules : {compiled, Ruleset::open(path)}) {
+        analyzer.setRuleset(rules);
+        EXPECT_DOUBLE_EQ(analyzer.analyzeText("use this coupon").confidence_score, 0.9);
+        // A category deducts its heaviest matching pattern once
+        EXPECT_DOUBLE_EQ(analyzer.analyzeText("buy a gift card").confidence_score, 0.7);
+        EXPECT_DOUBLE_EQ(analyzer.analyzeText("wire the funds for the gift card").confidence_score, 0.6);
+        // Deductions of different categories add up
+        EXPECT_DOUBLE_EQ(analyzer.analyzeText("coupon! act now and wire the funds").confidence_score, 0.2);
+        EXPECT_DOUBLE_EQ(analyzer.analyzeText("coupon, call 555-123-4567").confidence_score, 0.4);
+        EXPECT_FALSE(analyzer.isContentSafe("act now", 0.8));
+        EXPECT_TRUE(analyzer.isContentSafe("coupon", 0.8));
+    }
+
+    RuleCategory heavy{"Heavy", false, false, {"x"}};
+    heavy.weight = 1.5;
+    EXPECT_THROW(Ruleset::compile({heavy}), std::invalid_argument);
+    RuleCategory mismatched{"Mismatched", false, false, {"x", "y"}};
+    mismatched.pattern_weights = {0.2};
+    EXPECT_THROW(Ruleset::compile({mismatched}), std::invalid_argument);
+    createTestFile("unknown.json", R"([{"issue": "x", "patterns": ["a"], "pattern_weights": {"b": 0.1}}])");
+    EXPECT_THROW(loadRuleCategories((test_data_dir / "unknown.json").string()), std::runtime_error);
+}
+
+TEST_F(SecurityAnalyzerTest, TestBuiltinCategoriesAreGraded) {
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("decode the base64 blob").confidence_score, 0.9);
+    EXPECT_TRUE(analyzer.analyzeText("decode the base64 blob").is_safe);
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("popen('ls')").confidence_score, 0.75);
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("<script>").confidence_score, 0.4);
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("id=1' or 1=1--").confidence_score, 0.4);
+    // The malicious deductions saturate at maliciousWeight(), and PII on
+    // top does not take the score below 0
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("' or 1=1 <script> ../etc").confidence_score, 0.0);
+    EXPECT_DOUBLE_EQ(analyzer.analyzeText("' or 1=1 <script> call 555-123-4567").confidence_score, 0.0);
+}
+
+TEST_F(SecurityAnalyzerTest, TestProfilesShareOneRuleset) {
+    SecurityAnalyzer cached(0.8, 1, 1 << 20);
+    AnalysisProfile strict;
+    strict.threshold = 0.95;
+    AnalysisProfile lenient;
+    lenient.threshold = 0.4;
+    lenient.categories = {"Potential XSS attack detected"};
+    lenient.weights = {{"Potential XSS attack detected", 0.2}};
+    lenient.detect_pii = false;
+    cached.setProfile("strict", strict);
+    cached.setProfile("lenient", lenient);
+
+    const std::string attack = "'; DROP TABLE users; -- <script>alert(1)</script>";
+    auto full = cached.analyzeText(attack, "strict");
+    EXPECT_EQ(full.detectedIssues(), cached.analyzeText(attack).detectedIssues());
+    EXPECT_FALSE(full.is_safe);
+    // Only the enabled category is reported, with the profile's weight
+    auto partial = cached.analyzeText(attack, "lenient");
+    EXPECT_EQ(partial.detectedIssues(), std::vector<std::string>{"Potential XSS attack detected"});
+    EXPECT_DOUBLE_EQ(partial.confidence_score, 0.8);
+    EXPECT_TRUE(partial.is_safe);
+    EXPECT_TRUE(cached.analyzeText("mail john.doe@example.com", "lenient").detectedIssues().empty());
+    EXPECT_FALSE(cached.analyzeText("mail john.doe@example.com", "strict").is_safe);
+    // Cached per profile, not shared between them
+    EXPECT_EQ(cached.analyzeText(attack, "lenient").detectedIssues(), partial.detectedIssues());
+    EXPECT_EQ(cached.analyzeText(attack, "strict").detectedIssues(), full.detectedIssues());
+    EXPECT_EQ(cached.cacheStats().hits, 2u);
+
+    // Profiles are resolved again against new rules
+    RuleCategory fraud;
+    fraud.issue = "Potential XSS attack detected";
+    fraud.patterns = {"wire the funds"};
+    cached.setRuleset(Ruleset::compile({fraud}));
+    EXPECT_EQ(cached.analyzeText("wire the funds", "lenient").detectedIssues(), std::vector<std::string>{fraud.issue});
+
+    EXPECT_THROW(cached.analyzeText(attack, "missing"), std::invalid_argument);
+    AnalysisProfile unknown;
+    unknown.categories = {"No such category"};
+    EXPECT_THROW(cached.setProfile("unknown", unknown), std::invalid_argument);
+    AnalysisProfile heavy;
+    heavy.weights = {{fraud.issue, 2.0}};
+    EXPECT_THROW(cached.setProfile("heavy", heavy), std::invalid_argument);
+    EXPECT_TRUE(cached.removeProfile("lenient"));
+    EXPECT_FALSE(cached.removeProfile("lenient"));
+    EXPECT_THROW(cached.analyzeText(attack, "lenient"), std::invalid_argument);
+}
+
+TEST_F(SecurityAnalyzerTest, TestFilesJudgedUnderAProfile) {
+    SecurityAnalyzer cached(0.8, 1, 1 << 20);
+    RuleCategory fraud;
+    fraud.issue = "Potential fraud detected";
+    fraud.patterns = {"wire the funds"};
+    fraud.weight = 0.25;
+    RuleCategory spam;
+    spam.issue = "Potential spam detected";
+    spam.patterns = {"act now"};
+    cached.setRuleset(Ruleset::compile({fraud, spam}));
+    AnalysisProfile strict;
+    strict.threshold = 0.9;
+    AnalysisProfile lenient;
+    lenient.threshold = 0.5;
+    AnalysisProfile spam_only;
+    spam_only.categories = {spam.issue};
+    cached.setProfile("strict", strict);
+    cached.setProfile("lenient", lenient);
+    cached.setProfile("spam_only", spam_only);
+
+    // One fraud match scores 0.75, between the two thresholds
+    createTestFile("fraud.txt", "please wire the funds today");
+    createTestPDF("fraud.pdf", "please wire the funds today");
+    for (const char* name : {"fraud.txt", "fraud.pdf"}) {
+        const std::string path = (test_data_dir / name).string();
+        auto defaults = cached.analyzeFile(path);
+        auto under_strict = cached.analyzeFile(path, "strict");
+        auto under_lenient = cached.analyzeFile(path, "lenient");
+        EXPECT_FALSE(defaults.is_safe) << name;
+        EXPECT_FALSE(under_strict.is_safe) << name;
+        EXPECT_TRUE(under_lenient.is_safe) << name;
+        EXPECT_DOUBLE_EQ(under_lenient.confidence_score, 0.75) << name;
+        EXPECT_EQ(under_lenient.detectedIssues(), std::vector<std::string>{fraud.issue}) << name;
+        // The profile's categories apply too, and its results are cached apart
+        auto under_spam_only = cached.analyzeFile(path, "spam_only", AnalysisOptions());
+        EXPECT_TRUE(under_spam_only.is_safe) << name;
+        EXPECT_TRUE(under_spam_only.detectedIssues().empty()) << name;
+        EXPECT_TRUE(cached.analyzeFile(path, "lenient").is_safe) << name;
+        EXPECT_FALSE(cached.analyzeFile(path).is_safe) << name;
+    }
+
+    auto pdf = readFile((test_data_dir / "fraud.pdf").string());
+    EXPECT_TRUE(cached.analyzePDF(pdf, "lenient").is_safe);
+    EXPECT_FALSE(cached.analyzePDF(pdf, "strict").is_safe);
+    EXPECT_THROW(cached.analyzePDF(pdf, "missing"), std::invalid_argument);
+    EXPECT_THROW(cached.analyzeFile((test_data_dir / "fraud.txt").string(), "missing"), std::invalid_argument);
+}
+
+TEST_F(SecurityAnalyzerTest, TestRulesetDirectoryGenerations) {
+    const std::string dir = (test_data_dir / "shared_rules").string();
+    RulesetDirectory directory(dir);
+    EXPECT_EQ(directory.currentGeneration(), 0u);
+    EXPECT_THROW(directory.openCurrent(), std::runtime_error);
+    RulesetFollower follower(analyzer, directory);
+    EXPECT_FALSE(follower.poll());
+
+    RuleCategory fraud;
+    fraud.issue = "Potential fraud detected";
+    fraud.patterns = {"wire the funds"};
+    EXPECT_EQ(directory.publish(*Ruleset::compile({fraud})), 1u);
+    uint64_t generation = 0;
+    const auto first = directory.openCurrent(&generation);
+    EXPECT_EQ(generation, 1u);
+    EXPECT_TRUE(follower.poll());
+    EXPECT_FALSE(follower.poll());
+    EXPECT_EQ(follower.generation(), 1u);
+    EXPECT_FALSE(analyzer.analyzeText("please wire the funds").is_safe);
+
+    // Hot reload: followers move to the new generation, and only the
+    // previous one is kept on disk
+    EXPECT_EQ(directory.publish(*Ruleset::builtin()), 2u);
+    EXPECT_EQ(directory.publish(*Ruleset::builtin()), 3u);
+    EXPECT_TRUE(follower.poll());
+    EXPECT_EQ(follower.generation(), 3u);
+    EXPECT_TRUE(analyzer.analyzeText("please wire the funds").is_safe);
+    EXPECT_FALSE(fs::exists(fs::path(dir) / "ruleset.1"));
+    EXPECT_TRUE(fs::exists(fs::path(dir) / "ruleset.2"));
+    // A mapping of a deleted generation stays usable
+    SecurityAnalyzer old;
+    old.setRuleset(first);
+    EXPECT_FALSE(old.analyzeText("please wire the funds").is_safe);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,85 @@
+#include "../securityAnalyzer/AnalyzerServer.h"
+#include "../securityAnalyzer/Ruleset.h"
+#include "../securityAnalyzer/SecurityAnalyzer.h"
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+AnalyzerServer* running_server = nullptr;
+
+void onSignal(int) {
+    if (running_server) {
+        running_server->stop();
+    }
+}
+
+void usage(const char* program) {
+    std::cerr << "usage: " << program << " --socket PATH [--workers N] [--no-pin] [--threshold T]\n"
+              << "       [--cache-bytes N] [--ruleset COMPILED_FILE | --rules RULE_FILE.json ...]\n";
+}
+
+} // namespace
+
+// Serves one analyzer and one copy of the rules to every frontend worker on
+// the node, over the protocol in IpcProtocol.h. SIGINT and SIGTERM stop it
+// after the requests already running.
+int main(int argc, char** argv) {
+    ServerOptions options;
+    double threshold = 0.8;
+    size_t cache_bytes = 0;
+    std::string compiled_ruleset;
+    std::vector<std::string> rule_files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--socket" && has_value) {
+            options.socket_path = argv[++i];
+        } else if (arg == "--workers" && has_value) {
+            options.workers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-pin") {
+            options.pin_workers = false;
+        } else if (arg == "--threshold" && has_value) {
+            threshold = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--cache-bytes" && has_value) {
+            cache_bytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--ruleset" && has_value) {
+            compiled_ruleset = argv[++i];
+        } else if (arg == "--rules" && has_value) {
+            rule_files.push_back(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.socket_path.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        SecurityAnalyzer analyzer(threshold, options.workers, cache_bytes);
+        if (!compiled_ruleset.empty()) {
+            analyzer.setRuleset(Ruleset::open(compiled_ruleset));
+        } else if (!rule_files.empty()) {
+            analyzer.setRuleset(Ruleset::load(rule_files));
+        }
+
+        AnalyzerServer server(analyzer, options);
+        running_server = &server;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        std::cout << "Serving " << analyzer.ruleset()->patternCount() << " patterns on "
+                  << server.socketPath() << std::endl;
+        server.run();
+        running_server = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << "security_analyzer_server: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+import unittest
+
+from app.security import SecurityAnalyzer, _cpp_available
+
+
+@unittest.skipUnless(_cpp_available, "security_analyzer native module not built")
+class TestSecurityProfiles(unittest.TestCase):
+    def setUp(self):
+        self.analyzer = SecurityAnalyzer()
+        # Keep the verdicts to the native rules
+        self.analyzer.gemini_endpoint = None
+        self.analyzer.set_profile("strict", threshold=0.9)
+        self.analyzer.set_profile("lenient", threshold=0.5)
+
+    def test_profiles_judge_the_same_text_by_their_thresholds(self):
+        """One code execution match scores 0.75: under the strict threshold, over the lenient one"""
+        text = "p = popen('ls')"
+        strict = self.analyzer.analyze_text(text, profile_id="strict")
+        lenient = self.analyzer.analyze_text(text, profile_id="lenient")
+
+        self.assertFalse(strict["is_safe"])
+        self.assertTrue(lenient["is_safe"])
+        self.assertAlmostEqual(strict["confidence_score"], 0.75)
+        self.assertAlmostEqual(lenient["confidence_score"], 0.75)
+        self.assertEqual(strict["detected_issues"], lenient["detected_issues"])
+
+    def test_clean_text_is_safe_under_both(self):
+        for profile_id in ("strict", "lenient"):
+            result = self.analyzer.analyze_text("Hello, this is a safe message.", profile_id=profile_id)
+            self.assertTrue(result["is_safe"])
+            self.assertEqual(result["confidence_score"], 1.0)
+
+    def test_text_validation_ignores_pii_like_the_python_checks(self):
+        text = "Please reply to jane@example.org or call 555-123-4567."
+        for profile_id in (None, "strict"):
+            self.assertTrue(self.analyzer.analyze_text(text, profile_id=profile_id)["is_safe"])
+
+        native = self.analyzer.analyze_text(text)
+        self.analyzer.native_keywords = False
+        fallback = self.analyzer.analyze_text(text)
+        self.assertEqual(native["is_safe"], fallback["is_safe"])
+        self.assertEqual(native["detected_issues"], fallback["detected_issues"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,39 @@
+import unittest
+
+from app.security.service import SecurityService
+
+
+class TestSecurityServiceResults(unittest.TestCase):
+    def setUp(self):
+        self.service = SecurityService(security_level="high")
+
+    def test_reports_every_score_the_frontend_shows(self):
+        result = self.service._process_analysis_results({
+            'is_safe': False,
+            'confidence_score': 0.4,
+            'rule_score': 0.4,
+            'llm_score': 1.0,
+            'detected_issues': ['Potential XSS attack detected', 'harmful_keyword_detected'],
+            'analysis_summary': 'summary',
+        })
+        self.assertEqual(result["status"], "unsafe")
+        self.assertEqual(result["llm_score"], 1.0)
+        self.assertEqual(result["rule_score"], 0.4)
+        self.assertEqual(result["overall_score"], 0.4)
+        self.assertEqual(result["detected_issues"], ['Potential XSS attack detected', 'toxic_language'])
+
+    def test_file_results_have_no_language_model_pass(self):
+        result = self.service._process_analysis_results({
+            'is_safe': True,
+            'confidence_score': 0.9,
+            'detected_issues': [],
+            'analysis_summary': 'PDF analysis completed.',
+        })
+        self.assertEqual(result["status"], "safe")
+        self.assertEqual(result["llm_score"], 1.0)
+        self.assertEqual(result["rule_score"], 0.9)
+        self.assertEqual(result["overall_score"], 0.9)
+
+
+if __name__ == "__main__":
+    unittest.main()